@@ -98,6 +98,25 @@ gen_label_range(const binary_relation& br) {
 // All tests are discriminated by the size of the label alphabet as it is the
 // most  influential parameter.
 
+// Unlike the query benchmarks, the construction is discriminated by the size
+// of the object alphabet, as it sets how many labels each object holds.
+static void bm_construction(benchmark::State& state) {
+  constexpr std::size_t num_pairs = 1'000'000;
+  const auto max_object = object_id(state.range(0));
+  std::vector<pair_type> pairs;
+  pairs.reserve(num_pairs);
+  for (std::size_t i = 0; i < num_pairs; ++i) {
+    pairs.push_back({gen_object(object_id(0), max_object),
+                     gen_label(label_id(0), label_id(pow_2(20)))});
+  }
+
+  for (auto _ : state) {
+    DoNotOptimize(binary_relation(pairs));
+  }
+  state.SetItemsProcessed(state.iterations() * num_pairs);
+}
+BENCHMARK(bm_construction)->Arg(16)->Arg(1024)->Arg(pow_2(16));
+
 static void bm_rank(benchmark::State& state) {
   const auto br = gen_binary_relation(/*max_size=*/1'000'000,
                                       /*max_object=*/object_id(100'000),
@@ -0,0 +1,66 @@
+#include "brwt/bit_ops.h"
+#include "utility.h"
+#include "brwt/common_types.h"
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <vector>
+
+using brwt::detail::popcount_kernel;
+
+using brwt::benchmark::pow_2;
+
+using benchmark::DoNotOptimize;
+
+static std::vector<brwt::word_type> gen_words(const std::size_t count) {
+  std::vector<brwt::word_type> words(count);
+  for (auto& word : words) {
+    word = brwt::benchmark::get_random_engine()();
+  }
+  return words;
+}
+
+// The sizes are numbers of words: from a single super block to 128 MiB.
+static void buffer_sizes(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(16)->Range(8, pow_2(24));
+}
+
+template <popcount_kernel Kernel>
+static void bm_popcount(benchmark::State& state) {
+  if (!brwt::detail::is_supported(Kernel)) {
+    state.SkipWithError("The CPU does not support this kernel");
+    return;
+  }
+  const auto words = gen_words(static_cast<std::size_t>(state.range(0)));
+
+  for (auto _ : state) {
+    DoNotOptimize(brwt::detail::popcount(words, Kernel));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0) * 8);
+}
+BENCHMARK_TEMPLATE(bm_popcount, popcount_kernel::scalar)->Apply(buffer_sizes);
+BENCHMARK_TEMPLATE(bm_popcount, popcount_kernel::avx2)->Apply(buffer_sizes);
+BENCHMARK_TEMPLATE(bm_popcount, popcount_kernel::avx512)->Apply(buffer_sizes);
+
+template <popcount_kernel Kernel>
+static void bm_prefix_popcount(benchmark::State& state) {
+  if (!brwt::detail::is_supported(Kernel)) {
+    state.SkipWithError("The CPU does not support this kernel");
+    return;
+  }
+  const auto words = gen_words(static_cast<std::size_t>(state.range(0)));
+  std::vector<brwt::word_type> counts(words.size());
+
+  for (auto _ : state) {
+    brwt::detail::prefix_popcount(words, counts, Kernel);
+    DoNotOptimize(counts.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0) * 8);
+}
+BENCHMARK_TEMPLATE(bm_prefix_popcount, popcount_kernel::scalar)
+    ->Apply(buffer_sizes);
+BENCHMARK_TEMPLATE(bm_prefix_popcount, popcount_kernel::avx2)
+    ->Apply(buffer_sizes);
+BENCHMARK_TEMPLATE(bm_prefix_popcount, popcount_kernel::avx512)
+    ->Apply(buffer_sizes);
+
+BENCHMARK_MAIN();
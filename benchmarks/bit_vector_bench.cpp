@@ -0,0 +1,168 @@
+#include "brwt/bit_vector.h"
+#include "utility.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+using brwt::bit_vector;
+using brwt::bit_vector_builder;
+
+using brwt::benchmark::pow_2;
+
+using benchmark::DoNotOptimize;
+
+static std::vector<bool> gen_bits(const bit_vector::size_type count) {
+  std::vector<bool> bits(static_cast<std::size_t>(count));
+  auto& engine = brwt::benchmark::get_random_engine();
+  for (auto&& bit : bits) {
+    bit = (engine() & 1) != 0;
+  }
+  return bits;
+}
+
+// Filling a bit vector of known length with set().
+static void bm_fill_with_set(benchmark::State& state) {
+  const auto bits = gen_bits(state.range(0));
+
+  for (auto _ : state) {
+    bit_vector vec(state.range(0));
+    for (bit_vector::size_type i = 0; i < vec.size(); ++i) {
+      vec.set(i, bits[static_cast<std::size_t>(i)]);
+    }
+    DoNotOptimize(vec);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_fill_with_set)->Range(pow_2(12), pow_2(26));
+
+static void bm_builder_push_back(benchmark::State& state) {
+  const auto bits = gen_bits(state.range(0));
+
+  for (auto _ : state) {
+    bit_vector_builder builder;
+    for (const bool bit : bits) {
+      builder.push_back(bit);
+    }
+    DoNotOptimize(std::move(builder).build());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_builder_push_back)->Range(pow_2(12), pow_2(26));
+
+// Appends runs of 1 to 64 bits, as when writing fixed width codes.
+static void bm_builder_append_bits(benchmark::State& state) {
+  const auto count = state.range(0);
+  auto& engine = brwt::benchmark::get_random_engine();
+  std::vector<std::uint64_t> words(static_cast<std::size_t>(count / 16));
+  for (auto& word : words) {
+    word = engine();
+  }
+
+  for (auto _ : state) {
+    bit_vector_builder builder;
+    for (const auto word : words) {
+      builder.append_bits(word, static_cast<int>(word % 64) + 1);
+    }
+    DoNotOptimize(std::move(builder).build());
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(words.size()));
+}
+BENCHMARK(bm_builder_append_bits)->Range(pow_2(12), pow_2(26));
+
+static void bm_from_string(benchmark::State& state) {
+  const auto bits = gen_bits(state.range(0));
+  std::string str;
+  for (const bool bit : bits) {
+    str.push_back(bit ? '1' : '0');
+  }
+
+  for (auto _ : state) {
+    DoNotOptimize(bit_vector(str));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_from_string)->Range(pow_2(12), pow_2(26));
+
+static void bm_from_bools(benchmark::State& state) {
+  const auto bits = gen_bits(state.range(0));
+  const auto bools = std::make_unique<bool[]>(bits.size());
+  std::copy(bits.begin(), bits.end(), bools.get());
+
+  for (auto _ : state) {
+    DoNotOptimize(bit_vector(std::span<const bool>(bools.get(), bits.size())));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(bm_from_bools)->Range(pow_2(12), pow_2(26));
+
+// Reads and writes of consecutive chunks of `bpe` bits, as done by int_vector.
+static void chunk_args(benchmark::internal::Benchmark* bench) {
+  for (const int bpe : {1, 7, 13, 32, 57, 64}) {
+    bench->Arg(bpe);
+  }
+}
+
+constexpr bit_vector::size_type chunk_count = pow_2(16);
+
+static void bm_get_chunk(benchmark::State& state) {
+  const auto bpe = state.range(0);
+  bit_vector vec(chunk_count * bpe);
+  auto& engine = brwt::benchmark::get_random_engine();
+  for (bit_vector::size_type i = 0; i < vec.num_blocks(); ++i) {
+    vec.set_block(i, engine());
+  }
+  vec.set_chunk(vec.size() - bpe, bpe, 0); // Keeps the unused bits zero.
+
+  for (auto _ : state) {
+    bit_vector::block_type acc = 0;
+    for (bit_vector::size_type i = 0; i < chunk_count; ++i) {
+      acc += vec.get_chunk(i * bpe, bpe);
+    }
+    DoNotOptimize(acc);
+  }
+  state.SetItemsProcessed(state.iterations() * chunk_count);
+}
+BENCHMARK(bm_get_chunk)->Apply(chunk_args);
+
+static void bm_set_chunk(benchmark::State& state) {
+  const auto bpe = state.range(0);
+  bit_vector vec(chunk_count * bpe);
+
+  for (auto _ : state) {
+    for (bit_vector::size_type i = 0; i < chunk_count; ++i) {
+      vec.set_chunk(i * bpe, bpe, static_cast<bit_vector::block_type>(i));
+    }
+    DoNotOptimize(vec.get_blocks().data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * chunk_count);
+}
+BENCHMARK(bm_set_chunk)->Apply(chunk_args);
+
+// Shifts the vector down by 13 bits, as int_vector::erase does when it removes
+// an element of 13 bits.
+static void bm_copy_bits(benchmark::State& state) {
+  const auto count = state.range(0);
+  bit_vector vec(count);
+  auto& engine = brwt::benchmark::get_random_engine();
+  for (bit_vector::size_type i = 0; i < vec.num_blocks(); ++i) {
+    vec.set_block(i, engine());
+  }
+
+  for (auto _ : state) {
+    vec.copy_bits(vec, 13, 0, count - 13);
+    DoNotOptimize(vec.get_blocks().data());
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * count / 8);
+}
+BENCHMARK(bm_copy_bits)->Range(pow_2(12), pow_2(28));
+
+BENCHMARK_MAIN();
@@ -1,12 +1,20 @@
 #include "brwt/bitmap.h"
 #include "utility.h"
+#include "brwt/bit_ops.h"
 #include "brwt/bit_vector.h"
+#include "brwt/block_allocator.h"
 #include "brwt/common_types.h"
+#include "brwt/utility.h"
 #include <benchmark/benchmark.h>
+#include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <random>
+#include <span>
 #include <utility>
+#include <vector>
 
 using brwt::bitmap;
 using brwt::index_type;
@@ -33,12 +41,33 @@ static bitmap gen_bitmap(const size_type size, const double density = 0.5) {
   return bitmap(std::move(vec));
 }
 
-static index_type gen_index(const bitmap& bm) {
+/// Generates a bit vector with uniformly distributed bits. Faster than
+/// gen_bitmap for sizes beyond the last level cache.
+static brwt::bit_vector gen_uniform_bit_vector(
+    const size_type size,
+    const brwt::allocation_policy policy = brwt::allocation_policy::aligned) {
+  brwt::bit_vector vec(size, policy);
+  auto& engine = brwt::benchmark::get_random_engine();
+  for (size_type i = 0; i < vec.num_blocks(); ++i) {
+    vec.set_block(i, engine());
+  }
+  if (const auto extra = size % brwt::bit_vector::bits_per_block; extra != 0) {
+    const auto last = vec.num_blocks() - 1;
+    vec.set_block(last, vec.get_block(last) &
+                            brwt::lsb_mask<brwt::bit_vector::block_type>(
+                                static_cast<int>(extra)));
+  }
+  return vec;
+}
+
+template <typename Bitmap>
+static index_type gen_index(const Bitmap& bm) {
   assert(bm.size() > 0);
   return gen_integer<index_type>(0, bm.size() - 1);
 }
 
-static auto generate_random_indices(const bitmap& bm,
+template <typename Bitmap>
+static auto generate_random_indices(const Bitmap& bm,
                                     const std::size_t count = 1024) {
   assert(count > 0);
   cyclic_input<index_type> indices;
@@ -72,6 +101,81 @@ static void bm_rank_1(benchmark::State& state) {
 }
 BENCHMARK(bm_rank_1)->Range(pow_2(12), pow_2(20));
 
+// Layout matrix. Each benchmark reports the space of the bitmap in bits per
+// bit next to the query time.
+
+using brwt::counter_width;
+using brwt::rank_layout;
+
+template <typename Layout>
+static void bm_rank_1_layout(benchmark::State& state) {
+  const auto bm =
+      brwt::basic_bitmap<Layout>(gen_uniform_bit_vector(state.range(0)));
+  auto indices = generate_random_indices(bm, 1 << 16);
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.rank_1(indices.next()));
+  }
+  state.counters["bits_per_bit"] =
+      8.0 * static_cast<double>(bm.allocated_bytes()) /
+      static_cast<double>(bm.size());
+}
+
+template <typename Layout>
+static void bm_select_1_layout(benchmark::State& state) {
+  const auto bm =
+      brwt::basic_bitmap<Layout>(gen_uniform_bit_vector(state.range(0)));
+  auto input = cyclic_input<size_type>();
+  input.generate(1 << 16,
+                 [&] { return gen_integer<size_type>(1, bm.num_ones()); });
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.select_1(input.next()));
+  }
+  state.counters["bits_per_bit"] =
+      8.0 * static_cast<double>(bm.allocated_bytes()) /
+      static_cast<double>(bm.size());
+}
+
+static void layout_sizes(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(64)->Range(pow_2(12), pow_2(30));
+}
+
+using rank9 = rank_layout<8, counter_width::bits64, true>;
+using rank9_32 = rank_layout<8, counter_width::bits32, true>;
+using rank9_4 = rank_layout<4, counter_width::bits64, true>;
+using packed_8 = rank_layout<8, counter_width::packed, false>;
+using flat64_8 = rank_layout<8, counter_width::bits64, false>;
+using flat32_16 = rank_layout<16, counter_width::bits32, false>;
+using packed_32 = rank_layout<32, counter_width::packed, false>;
+using flat32_32 = rank_layout<32, counter_width::bits32, false>;
+using rel32_8 = rank_layout<8, counter_width::relative32, false>;
+using rel16_8 = rank_layout<8, counter_width::relative16, false>;
+using rel16_32 = rank_layout<32, counter_width::relative16, false>;
+
+BENCHMARK_TEMPLATE(bm_rank_1_layout, rank9)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_rank_1_layout, rank9_32)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_rank_1_layout, rank9_4)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_rank_1_layout, packed_8)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_rank_1_layout, flat64_8)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_rank_1_layout, flat32_16)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_rank_1_layout, packed_32)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_rank_1_layout, flat32_32)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_rank_1_layout, rel32_8)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_rank_1_layout, rel16_8)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_rank_1_layout, rel16_32)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, rank9)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, rank9_32)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, rank9_4)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, packed_8)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, flat64_8)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, flat32_16)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, packed_32)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, flat32_32)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, rel32_8)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, rel16_8)->Apply(layout_sizes);
+BENCHMARK_TEMPLATE(bm_select_1_layout, rel16_32)->Apply(layout_sizes);
+
 static void bm_select_1(benchmark::State& state) {
   const auto bm = gen_bitmap(state.range(0));
   auto input = cyclic_input<size_type>();
@@ -102,4 +206,222 @@ static void bm_select_0(benchmark::State& state) {
 }
 BENCHMARK(bm_select_0)->Range(pow_2(12), pow_2(20));
 
+// Measures select_1 for several select sample rates. A rate of zero disables
+// the samples.
+static void bm_select_1_sampling(benchmark::State& state) {
+  const auto bm =
+      bitmap(gen_uniform_bit_vector(state.range(0)),
+             brwt::bitmap_options{.select_sample_rate = state.range(1)});
+  auto input = cyclic_input<size_type>();
+  input.generate(1 << 16,
+                 [&] { return gen_integer<size_type>(1, bm.num_ones()); });
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.select_1(input.next()));
+  }
+}
+BENCHMARK(bm_select_1_sampling)
+    ->ArgsProduct({{pow_2(20), pow_2(26), pow_2(30)}, {0, 1024, 4096, 16384}});
+
+// Compares the throughput of independent queries answered one at a time and
+// in a batch. The sizes go well beyond the last level cache, where each single
+// query stalls on memory.
+
+static void batch_sizes(benchmark::internal::Benchmark* bench) {
+  for (const std::int64_t size :
+       {std::int64_t{pow_2(20)}, std::int64_t{pow_2(26)},
+        std::int64_t{pow_2(30)}, std::int64_t{1} << 32}) {
+    bench->Arg(size);
+  }
+}
+
+/// Splits a large pool of random queries in consecutive batches, so that the
+/// queries of a batch are not cached by the previous iterations.
+template <typename T>
+class batch_input {
+public:
+  static constexpr std::size_t batch_size = 1024;
+
+  template <typename Generator>
+  explicit batch_input(Generator g) : pool(std::size_t{1} << 20) {
+    std::ranges::generate(pool, g);
+  }
+
+  std::span<const T> next() {
+    if (offset == pool.size()) {
+      offset = 0;
+    }
+    offset += batch_size;
+    return std::span<const T>(pool).subspan(offset - batch_size, batch_size);
+  }
+
+private:
+  std::vector<T> pool;
+  std::size_t offset = 0;
+};
+
+static void bm_rank_1_single(benchmark::State& state) {
+  const auto bm = bitmap(gen_uniform_bit_vector(state.range(0)));
+  batch_input<index_type> input([&] { return gen_index(bm); });
+  std::vector<size_type> out(input.batch_size);
+
+  for (auto _ : state) {
+    const auto positions = input.next();
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      out[i] = bm.rank_1(positions[i]);
+    }
+    DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.batch_size);
+}
+BENCHMARK(bm_rank_1_single)->Apply(batch_sizes);
+
+static void bm_rank_1_batch(benchmark::State& state) {
+  const auto bm = bitmap(gen_uniform_bit_vector(state.range(0)));
+  batch_input<index_type> input([&] { return gen_index(bm); });
+  std::vector<size_type> out(input.batch_size);
+
+  for (auto _ : state) {
+    bm.rank_1(input.next(), out);
+    DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.batch_size);
+}
+BENCHMARK(bm_rank_1_batch)->Apply(batch_sizes);
+
+static void bm_select_1_single(benchmark::State& state) {
+  const auto bm = bitmap(gen_uniform_bit_vector(state.range(0)));
+  batch_input<size_type> input(
+      [&] { return gen_integer<size_type>(1, bm.num_ones()); });
+  std::vector<index_type> out(input.batch_size);
+
+  for (auto _ : state) {
+    const auto nths = input.next();
+    for (std::size_t i = 0; i < nths.size(); ++i) {
+      out[i] = bm.select_1(nths[i]);
+    }
+    DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.batch_size);
+}
+BENCHMARK(bm_select_1_single)->Apply(batch_sizes);
+
+static void bm_select_1_batch(benchmark::State& state) {
+  const auto bm = bitmap(gen_uniform_bit_vector(state.range(0)));
+  batch_input<size_type> input(
+      [&] { return gen_integer<size_type>(1, bm.num_ones()); });
+  std::vector<index_type> out(input.batch_size);
+
+  for (auto _ : state) {
+    bm.select_1(input.next(), out);
+    DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.batch_size);
+}
+BENCHMARK(bm_select_1_batch)->Apply(batch_sizes);
+
+// Compares random rank queries on regular and huge pages.
+static void bm_rank_1_pages(benchmark::State& state) {
+  const auto policy = static_cast<brwt::allocation_policy>(state.range(1));
+  const auto bm = bitmap(gen_uniform_bit_vector(state.range(0), policy));
+  auto indices = generate_random_indices(bm, 1 << 16);
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.rank_1(indices.next()));
+  }
+}
+BENCHMARK(bm_rank_1_pages)->Apply([](benchmark::internal::Benchmark* bench) {
+  using brwt::allocation_policy;
+  for (const auto policy :
+       {allocation_policy::aligned, allocation_policy::huge_pages}) {
+    bench->Args({pow_2(30), static_cast<std::int64_t>(policy)});
+    bench->Args({std::int64_t{1} << 32, static_cast<std::int64_t>(policy)});
+  }
+});
+
+// Measures the construction of the rank directory with several threads.
+static void bm_construction(benchmark::State& state) {
+  const auto vec = gen_uniform_bit_vector(state.range(0));
+  const auto options = brwt::bitmap_options{
+      .select_sample_rate = 0, .num_threads = static_cast<int>(state.range(1))};
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto copy = vec;
+    state.ResumeTiming();
+    DoNotOptimize(bitmap(std::move(copy), options));
+  }
+  state.SetBytesProcessed(state.iterations() * vec.allocated_bytes());
+}
+BENCHMARK(bm_construction)
+    ->ArgsProduct({{pow_2(26), pow_2(30)}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+// Intersection built from the raw blocks and then indexed in a second pass.
+static void bm_and_two_passes(benchmark::State& state) {
+  const auto lhs = gen_uniform_bit_vector(state.range(0));
+  const auto rhs = gen_uniform_bit_vector(state.range(0));
+
+  for (auto _ : state) {
+    brwt::bit_vector result(lhs.size());
+    for (size_type i = 0; i < result.num_blocks(); ++i) {
+      result.set_block(i, lhs.get_block(i) & rhs.get_block(i));
+    }
+    DoNotOptimize(bitmap(std::move(result)));
+  }
+  state.SetBytesProcessed(state.iterations() * 3 * lhs.allocated_bytes());
+}
+BENCHMARK(bm_and_two_passes)->Range(pow_2(16), pow_2(30));
+
+static void bm_bit_and(benchmark::State& state) {
+  const auto lhs = bitmap(gen_uniform_bit_vector(state.range(0)));
+  const auto rhs = bitmap(gen_uniform_bit_vector(state.range(0)));
+
+  for (auto _ : state) {
+    DoNotOptimize(lhs.bit_and(rhs));
+  }
+  state.SetBytesProcessed(state.iterations() * 3 * (state.range(0) / 8));
+}
+BENCHMARK(bm_bit_and)->Range(pow_2(16), pow_2(30));
+
+// Enumeration of the positions of the ones. The second argument is the
+// density of ones, in percent.
+static void enumeration_args(benchmark::internal::Benchmark* bench) {
+  bench->ArgsProduct({{pow_2(16), pow_2(24)}, {1, 50}});
+}
+
+static void bm_enumerate_select(benchmark::State& state) {
+  const auto bm = gen_bitmap(state.range(0), state.range(1) / 100.0);
+
+  for (auto _ : state) {
+    for (size_type nth = 1; nth <= bm.num_ones(); ++nth) {
+      DoNotOptimize(bm.select_1(nth));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * bm.num_ones());
+}
+BENCHMARK(bm_enumerate_select)->Apply(enumeration_args);
+
+static void bm_for_each_one(benchmark::State& state) {
+  const auto bm = gen_bitmap(state.range(0), state.range(1) / 100.0);
+
+  for (auto _ : state) {
+    bm.for_each_one(0, bm.size(), [](index_type pos) { DoNotOptimize(pos); });
+  }
+  state.SetItemsProcessed(state.iterations() * bm.num_ones());
+}
+BENCHMARK(bm_for_each_one)->Apply(enumeration_args);
+
+static void bm_ones_iterator(benchmark::State& state) {
+  const auto bm = gen_bitmap(state.range(0), state.range(1) / 100.0);
+
+  for (auto _ : state) {
+    for (const index_type pos : bm.ones(0, bm.size())) {
+      DoNotOptimize(pos);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * bm.num_ones());
+}
+BENCHMARK(bm_ones_iterator)->Apply(enumeration_args);
+
 BENCHMARK_MAIN();
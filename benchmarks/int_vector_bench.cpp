@@ -0,0 +1,127 @@
+#include "brwt/int_vector.h"
+#include "utility.h"
+#include "brwt/bit_ops.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+using brwt::int_vector;
+
+using benchmark::DoNotOptimize;
+using brwt::benchmark::get_random_engine;
+
+using size_type = int_vector::size_type;
+using value_type = int_vector::value_type;
+
+constexpr size_type elem_count = size_type{1} << 20;
+
+static void bpe_args(benchmark::internal::Benchmark* bench) {
+  for (const int bpe : {1, 7, 13, 32, 57}) {
+    bench->Arg(bpe);
+  }
+}
+
+static std::vector<value_type> gen_values(const int bpe) {
+  std::vector<value_type> values(elem_count);
+  const auto mask = brwt::lsb_mask<value_type>(bpe);
+  std::generate(values.begin(), values.end(),
+                [&] { return get_random_engine()() & mask; });
+  return values;
+}
+
+static int_vector gen_int_vector(const int bpe) {
+  const auto values = gen_values(bpe);
+  int_vector vec(elem_count, bpe);
+  vec.encode(0, values);
+  return vec;
+}
+
+static void bm_iterate(benchmark::State& state) {
+  const auto vec = gen_int_vector(static_cast<int>(state.range(0)));
+
+  for (auto _ : state) {
+    value_type acc = 0;
+    for (const auto value : vec) {
+      acc += value;
+    }
+    DoNotOptimize(acc);
+  }
+  state.SetItemsProcessed(state.iterations() * elem_count);
+}
+BENCHMARK(bm_iterate)->Apply(bpe_args);
+
+static void bm_decode(benchmark::State& state) {
+  const auto vec = gen_int_vector(static_cast<int>(state.range(0)));
+  std::vector<value_type> out(elem_count);
+
+  for (auto _ : state) {
+    vec.decode(0, out);
+    DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * elem_count);
+}
+BENCHMARK(bm_decode)->Apply(bpe_args);
+
+static void bm_assign(benchmark::State& state) {
+  const auto bpe = static_cast<int>(state.range(0));
+  const auto values = gen_values(bpe);
+  int_vector vec(elem_count, bpe);
+
+  for (auto _ : state) {
+    std::copy(values.begin(), values.end(), vec.begin());
+    DoNotOptimize(vec);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * elem_count);
+}
+BENCHMARK(bm_assign)->Apply(bpe_args);
+
+static void bm_encode(benchmark::State& state) {
+  const auto bpe = static_cast<int>(state.range(0));
+  const auto values = gen_values(bpe);
+  int_vector vec(elem_count, bpe);
+
+  for (auto _ : state) {
+    vec.encode(0, values);
+    DoNotOptimize(vec);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * elem_count);
+}
+BENCHMARK(bm_encode)->Apply(bpe_args);
+
+static void bm_push_back(benchmark::State& state) {
+  const auto bpe = static_cast<int>(state.range(0));
+  const auto values = gen_values(bpe);
+
+  for (auto _ : state) {
+    int_vector vec(0, bpe);
+    for (const auto value : values) {
+      vec.push_back(value);
+    }
+    DoNotOptimize(vec);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * elem_count);
+}
+BENCHMARK(bm_push_back)->Apply(bpe_args);
+
+// Compares vectors with different bits per element, so they are decoded.
+static void bm_equal(benchmark::State& state) {
+  const auto bpe = static_cast<int>(state.range(0));
+  const auto values = gen_values(bpe);
+  int_vector lhs(elem_count, bpe);
+  int_vector rhs(elem_count, bpe + 1);
+  lhs.encode(0, values);
+  rhs.encode(0, values);
+
+  for (auto _ : state) {
+    DoNotOptimize(lhs == rhs);
+  }
+  state.SetItemsProcessed(state.iterations() * elem_count);
+}
+BENCHMARK(bm_equal)->Apply(bpe_args);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,131 @@
+#include "brwt/rrr_bitmap.h"
+#include "utility.h"
+#include "brwt/bit_vector.h"
+#include "brwt/bitmap.h"
+#include "brwt/common_types.h"
+#include <benchmark/benchmark.h>
+#include <cassert>
+#include <cstddef>
+#include <random>
+
+using brwt::bitmap;
+using brwt::index_type;
+using brwt::rrr_bitmap;
+using brwt::size_type;
+
+using brwt::benchmark::cyclic_input;
+using brwt::benchmark::gen_integer;
+using brwt::benchmark::pow_2;
+
+using benchmark::DoNotOptimize;
+
+// ==========================================
+// Random data generation
+// ==========================================
+
+static brwt::bit_vector gen_bit_vector(const size_type size,
+                                       const double density) {
+  brwt::bit_vector vec(size);
+  std::bernoulli_distribution gen_bit(density);
+
+  for (size_type i = 0; i < size; ++i) {
+    vec.set(i, gen_bit(brwt::benchmark::get_random_engine()));
+  }
+  return vec;
+}
+
+/// Builds the bitmap of the benchmark. The first argument is the size of the
+/// bitmap, and the second one is the density of ones in per mille.
+template <typename Bitmap>
+static Bitmap gen_bitmap(const benchmark::State& state) {
+  const auto density = static_cast<double>(state.range(1)) / 1000.0;
+  return Bitmap(gen_bit_vector(state.range(0), density));
+}
+
+/// Reports the space used by the bitmap, in bits per original bit.
+template <typename Bitmap>
+static void set_space_counter(benchmark::State& state, const Bitmap& bm) {
+  state.counters["bits_per_bit"] =
+      static_cast<double>(bm.allocated_bytes() * 8) /
+      static_cast<double>(bm.size());
+}
+
+template <typename Bitmap>
+static auto generate_random_indices(const Bitmap& bm) {
+  assert(bm.size() > 0);
+  auto indices = cyclic_input<index_type>();
+  indices.generate(1024,
+                   [&] { return gen_integer<index_type>(0, bm.size() - 1); });
+  return indices;
+}
+
+static auto generate_select_input(const size_type count) {
+  assert(count > 0);
+  auto input = cyclic_input<size_type>();
+  input.generate(1024, [&] { return gen_integer<size_type>(1, count); });
+  return input;
+}
+
+static void apply_arguments(benchmark::internal::Benchmark* bench) {
+  for (const int density : {1, 10, 50, 200, 500}) {
+    bench->Args({pow_2(22), density});
+  }
+}
+
+// ==========================================
+// Benchmark tests
+// ==========================================
+
+template <typename Bitmap>
+static void bm_access(benchmark::State& state) {
+  const auto bm = gen_bitmap<Bitmap>(state);
+  auto indices = generate_random_indices(bm);
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.access(indices.next()));
+  }
+  set_space_counter(state, bm);
+}
+BENCHMARK_TEMPLATE(bm_access, bitmap)->Apply(apply_arguments);
+BENCHMARK_TEMPLATE(bm_access, rrr_bitmap)->Apply(apply_arguments);
+
+template <typename Bitmap>
+static void bm_rank_1(benchmark::State& state) {
+  const auto bm = gen_bitmap<Bitmap>(state);
+  auto indices = generate_random_indices(bm);
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.rank_1(indices.next()));
+  }
+  set_space_counter(state, bm);
+}
+BENCHMARK_TEMPLATE(bm_rank_1, bitmap)->Apply(apply_arguments);
+BENCHMARK_TEMPLATE(bm_rank_1, rrr_bitmap)->Apply(apply_arguments);
+
+template <typename Bitmap>
+static void bm_select_1(benchmark::State& state) {
+  const auto bm = gen_bitmap<Bitmap>(state);
+  auto input = generate_select_input(bm.num_ones());
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.select_1(input.next()));
+  }
+  set_space_counter(state, bm);
+}
+BENCHMARK_TEMPLATE(bm_select_1, bitmap)->Apply(apply_arguments);
+BENCHMARK_TEMPLATE(bm_select_1, rrr_bitmap)->Apply(apply_arguments);
+
+template <typename Bitmap>
+static void bm_select_0(benchmark::State& state) {
+  const auto bm = gen_bitmap<Bitmap>(state);
+  auto input = generate_select_input(bm.num_zeros());
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.select_0(input.next()));
+  }
+  set_space_counter(state, bm);
+}
+BENCHMARK_TEMPLATE(bm_select_0, bitmap)->Apply(apply_arguments);
+BENCHMARK_TEMPLATE(bm_select_0, rrr_bitmap)->Apply(apply_arguments);
+
+BENCHMARK_MAIN();
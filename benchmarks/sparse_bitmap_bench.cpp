@@ -0,0 +1,124 @@
+#include "brwt/sparse_bitmap.h"
+#include "utility.h"
+#include "brwt/bit_vector.h"
+#include "brwt/bitmap.h"
+#include "brwt/common_types.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <random>
+
+using brwt::bitmap;
+using brwt::size_type;
+using brwt::sparse_bitmap;
+
+using brwt::benchmark::cyclic_input;
+using brwt::benchmark::gen_integer;
+using brwt::benchmark::pow_2;
+
+using benchmark::DoNotOptimize;
+
+// ==========================================
+// Random data generation
+// ==========================================
+
+static brwt::bit_vector gen_bit_vector(const size_type size,
+                                       const double density) {
+  brwt::bit_vector vec(size);
+  std::bernoulli_distribution gen_bit(density);
+
+  for (size_type i = 0; i < size; ++i) {
+    vec.set(i, gen_bit(brwt::benchmark::get_random_engine()));
+  }
+  return vec;
+}
+
+/// Builds the bitmap of the benchmark. The first argument is the size of the
+/// bitmap, and the second one is the density of ones in per mille.
+template <typename Bitmap>
+static Bitmap gen_bitmap(const benchmark::State& state) {
+  const auto density = static_cast<double>(state.range(1)) / 1000.0;
+  return Bitmap(gen_bit_vector(state.range(0), density));
+}
+
+/// Reports the space used by the bitmap, in bits per original bit.
+template <typename Bitmap>
+static void set_space_counter(benchmark::State& state, const Bitmap& bm) {
+  state.counters["bits_per_bit"] =
+      static_cast<double>(bm.allocated_bytes() * 8) /
+      static_cast<double>(bm.size());
+}
+
+static auto generate_select_input(const size_type count) {
+  assert(count > 0);
+  auto input = cyclic_input<size_type>();
+  input.generate(1024, [&] { return gen_integer<size_type>(1, count); });
+  return input;
+}
+
+// The densities are those of the object boundaries of a binary relation with
+// 1, 4, 16, 64 and 256 pairs per object: one set bit per object, one clear
+// bit per pair.
+static void apply_arguments(benchmark::internal::Benchmark* bench) {
+  for (const int density : {500, 200, 59, 15, 4}) {
+    bench->Args({pow_2(22), density});
+  }
+}
+
+// ==========================================
+// Benchmark tests
+// ==========================================
+
+template <typename Bitmap>
+static void bm_select_1(benchmark::State& state) {
+  const auto bm = gen_bitmap<Bitmap>(state);
+  auto input = generate_select_input(bm.num_ones());
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.select_1(input.next()));
+  }
+  set_space_counter(state, bm);
+}
+BENCHMARK_TEMPLATE(bm_select_1, bitmap)->Apply(apply_arguments);
+BENCHMARK_TEMPLATE(bm_select_1, sparse_bitmap)->Apply(apply_arguments);
+
+template <typename Bitmap>
+static void bm_select_0(benchmark::State& state) {
+  const auto bm = gen_bitmap<Bitmap>(state);
+  auto input = generate_select_input(bm.num_zeros());
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.select_0(input.next()));
+  }
+  set_space_counter(state, bm);
+}
+BENCHMARK_TEMPLATE(bm_select_0, bitmap)->Apply(apply_arguments);
+BENCHMARK_TEMPLATE(bm_select_0, sparse_bitmap)->Apply(apply_arguments);
+
+// The object boundaries of a binary relation with 16 pairs per object, where
+// one object in 4096 starts a run of 4096 empty objects, that is, of set bits.
+template <typename Bitmap>
+static void bm_select_0_with_empty_objects(benchmark::State& state) {
+  auto vec = gen_bit_vector(state.range(0), 0.059);
+  for (size_type i = 0; i < vec.size(); ++i) {
+    if (vec.get(i) && gen_integer(0, 4095) == 0) {
+      const auto last = std::min(vec.size(), i + 4096);
+      for (; i < last; ++i) {
+        vec.set(i, true);
+      }
+    }
+  }
+  const auto bm = Bitmap(vec);
+  auto input = generate_select_input(bm.num_zeros());
+
+  for (auto _ : state) {
+    DoNotOptimize(bm.select_0(input.next()));
+  }
+  set_space_counter(state, bm);
+}
+BENCHMARK_TEMPLATE(bm_select_0_with_empty_objects, bitmap)->Arg(pow_2(22));
+BENCHMARK_TEMPLATE(bm_select_0_with_empty_objects, sparse_bitmap)
+    ->Arg(pow_2(22));
+
+BENCHMARK_MAIN();
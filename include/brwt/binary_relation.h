@@ -1,8 +1,10 @@
 #ifndef BRWT_BINARY_RELATION_H
 #define BRWT_BINARY_RELATION_H
 
-#include "brwt/bitmap.h"
+#include "brwt/bit_vector.h"
 #include "brwt/common_types.h"
+#include "brwt/image.h"
+#include "brwt/sparse_bitmap.h"
 #include "brwt/wavelet_tree.h"
 #include <optional>
 #include <vector>
@@ -32,6 +34,7 @@ class binary_relation {
 public:
   // member types
   using size_type = types::size_type;
+  using allocator_type = bit_vector::allocator_type;
   enum class object_id : types::size_type {};
   enum class label_id : types::size_type {};
 
@@ -50,6 +53,10 @@ public:
   /// The input sequence is not required to satisfy any order and can contain
   /// duplicate elements (they will be discarded).
   ///
+  /// The relation and its intermediate sequences are allocated with \p
+  /// alloc, which can be an \c allocation_policy or a \c
+  /// std::pmr::memory_resource pointer.
+  ///
   /// \post \c size() will be equal to the number of unique pairs.
   /// \post \c object_alphabet_size() will be equal to the maximum object-id in
   /// \p pairs plus 1.
@@ -62,7 +69,8 @@ public:
   /// The space complexity of the extra storage used by this constructor is
   /// \f$O(n)\f$.
   ///
-  explicit binary_relation(const std::vector<pair_type>& pairs);
+  explicit binary_relation(const std::vector<pair_type>& pairs,
+                           const allocator_type& alloc = {});
 
   /// \name Relation view
   /// @{
@@ -200,6 +208,21 @@ public:
   ///
   size_type label_alphabet_size() const noexcept;
 
+  /// \brief Appends the binary relation to an image.
+  ///
+  /// \see image
+  ///
+  void save(image& img) const;
+
+  /// \brief Returns a binary relation that views the next binary relation
+  /// saved in the image of \p reader.
+  ///
+  /// \throws std::length_error if the image is truncated or corrupted.
+  ///
+  /// \see image
+  ///
+  static binary_relation view(image_reader& reader);
+
   /// @}
 
 private:
@@ -214,7 +237,7 @@ private:
 
   // member data
   wavelet_tree m_wtree;
-  bitmap m_bitmap;
+  sparse_bitmap m_bitmap;
 };
 
 // ==========================================
@@ -231,7 +254,7 @@ inline auto binary_relation::num_objects() const noexcept -> size_type {
 
 inline auto binary_relation::object_alphabet_size() const noexcept
     -> size_type {
-  return m_bitmap.length() - size();
+  return m_bitmap.size() - size();
 }
 
 inline auto binary_relation::label_alphabet_size() const noexcept -> size_type {
@@ -1,11 +1,21 @@
 #ifndef BRWT_BIT_OPS_H
 #define BRWT_BIT_OPS_H
 
+#include "brwt/common_types.h"
 #include "brwt/concepts.h"
+#include <array>
 #include <bit>
 #include <cassert>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <span>
+#include <type_traits>
+
+#if defined(__BMI2__)
+#  include <immintrin.h>
+#endif
 
 namespace brwt {
 
@@ -60,6 +70,181 @@ constexpr int rank_0(const T value, const int pos) noexcept {
   return rank_1(~value, pos);
 }
 
+namespace detail {
+
+/// \brief Table of in-byte selections.
+///
+/// The element at <tt>(r << 8) | byte</tt> is the position of the
+/// <tt>(r + 1)</tt>-th set bit of \c byte, or 8 if there is no such bit.
+///
+inline constexpr auto select_in_byte_table = [] {
+  std::array<std::uint8_t, 8 * 256> table{};
+  for (int byte = 0; byte < 256; ++byte) {
+    for (int r = 0; r < 8; ++r) {
+      int seen = 0;
+      int pos = 0;
+      for (; pos < 8; ++pos) {
+        if ((byte >> pos & 1) != 0 && seen++ == r) {
+          break;
+        }
+      }
+      table[static_cast<std::size_t>(r << 8 | byte)] =
+          static_cast<std::uint8_t>(pos);
+    }
+  }
+  return table;
+}();
+
+/// \brief Branchless broadword implementation of \c select_1.
+///
+/// Computes the cumulative popcount of every byte in parallel, locates the
+/// byte that contains the answer with a single comparison over all the bytes,
+/// and finishes with a table lookup.
+///
+constexpr int broadword_select_1(const std::uint64_t value,
+                                 const int nth) noexcept {
+  constexpr std::uint64_t ones_step_8 = 0x0101'0101'0101'0101;
+  constexpr std::uint64_t msbs_step_8 = 0x8080'8080'8080'8080;
+
+  auto sums = value - ((value >> 1) & 0x5555'5555'5555'5555);
+  sums = (sums & 0x3333'3333'3333'3333) + ((sums >> 2) & 0x3333'3333'3333'3333);
+  sums = (sums + (sums >> 4)) & 0x0F0F'0F0F'0F0F'0F0F;
+  sums *= ones_step_8; // Byte j holds the popcount of bytes [0, j].
+
+  // The msb of byte j is set if and only if sums[j] >= nth.
+  const auto nth_step_8 = static_cast<std::uint64_t>(128 - nth) * ones_step_8;
+  const auto byte_pos =
+      std::countr_zero((sums + nth_step_8) & msbs_step_8) & ~7;
+
+  // Number of set bits before the selected byte (zero for the first byte).
+  const auto prev_sum = static_cast<int>(((sums << 8) >> byte_pos) & 0xFF);
+  const auto byte = static_cast<int>((value >> byte_pos) & 0xFF);
+
+  const auto idx = static_cast<std::size_t>((nth - prev_sum - 1) << 8 | byte);
+  return byte_pos + select_in_byte_table[idx];
+}
+
+/// \brief Runtime-dispatched \c select_1 for 64-bit words.
+///
+/// Uses PDEP and TZCNT when the running CPU supports BMI2, and \c
+/// broadword_select_1 otherwise.
+///
+int dispatched_select_1(std::uint64_t value, int nth) noexcept;
+
+/// \brief Counts the set bits of \p words with the widest kernel supported by
+/// the running CPU (see \c popcount_kernel).
+///
+std::int64_t dispatched_popcount(std::span<const word_type> words) noexcept;
+
+/// \brief Number of words below which \c popcount counts inline, if POPCNT
+/// is enabled at compile time, because the indirect call to a kernel costs
+/// more than the counting.
+///
+inline constexpr std::size_t max_inline_popcount_words = 8;
+
+} // namespace detail
+
+/// \brief Finds the position of the \e nth set bit of \p value.
+///
+/// \pre <tt>nth > 0 && nth <= rank_1(value)</tt>
+///
+/// \par Complexity
+/// Constant. When BMI2 is enabled at compile time, this function is a PDEP
+/// followed by a TZCNT. Otherwise, the instruction set is checked at run time.
+///
+template <large_unsigned_integer T>
+constexpr int select_1(const T value, const int nth) noexcept {
+  static_assert(std::numeric_limits<T>::digits <= 64);
+  assert(nth > 0 && nth <= rank_1(value));
+
+  const auto word = static_cast<std::uint64_t>(value);
+  if (std::is_constant_evaluated()) {
+    return detail::broadword_select_1(word, nth);
+  }
+#if defined(__BMI2__)
+  return std::countr_zero(_pdep_u64(std::uint64_t{1} << (nth - 1), word));
+#else
+  return detail::dispatched_select_1(word, nth);
+#endif
+}
+
+/// \brief Finds the position of the \e nth unset bit of \p value.
+///
+/// \pre <tt>nth > 0 && nth <= rank_0(value)</tt>
+///
+template <large_unsigned_integer T>
+constexpr int select_0(const T value, const int nth) noexcept {
+  return select_1(static_cast<T>(~value), nth);
+}
+
+/// \brief Counts the set bits of a sequence of words, such as the blocks of a
+/// \c bit_vector.
+///
+/// \par Complexity
+/// Linear in <tt>words.size()</tt>. The words are processed with the widest
+/// kernel supported by the running CPU (see \c detail::popcount_kernel).
+/// When POPCNT is enabled at compile time, short sequences, like the blocks of
+/// a super block, are counted inline instead.
+///
+inline std::int64_t popcount(const std::span<const word_type> words) noexcept {
+#if defined(__POPCNT__)
+  if (words.size() < detail::max_inline_popcount_words) {
+    std::int64_t count = 0;
+    for (const auto word : words) {
+      count += std::popcount(word);
+    }
+    return count;
+  }
+#endif
+  return detail::dispatched_popcount(words);
+}
+
+/// \brief Computes the inclusive prefix popcounts of a sequence of words.
+///
+/// Sets <tt>out[i]</tt> to the number of set bits in <tt>words[0..i]</tt>.
+///
+/// \pre <tt>out.size() == words.size()</tt>
+///
+void prefix_popcount(std::span<const word_type> words,
+                     std::span<word_type> out) noexcept;
+
+namespace detail {
+
+/// \brief Implementations of \c popcount and \c prefix_popcount.
+///
+enum class popcount_kernel {
+  /// One POPCNT (or its software emulation) per word.
+  scalar,
+
+  /// Harley-Seal carry-save adders over 256-bit vectors, with an in-register
+  /// nibble lookup (PSHUFB) to count the bits of each vector.
+  avx2,
+
+  /// 512-bit VPOPCNTQ.
+  avx512,
+};
+
+/// \brief Checks whether the running CPU supports the given kernel.
+///
+bool is_supported(popcount_kernel kernel) noexcept;
+
+/// \brief Invokes \c popcount with the given kernel.
+///
+/// \pre <tt>is_supported(kernel)</tt>
+///
+std::int64_t popcount(std::span<const word_type> words,
+                      popcount_kernel kernel) noexcept;
+
+/// \brief Invokes \c prefix_popcount with the given kernel.
+///
+/// \pre <tt>is_supported(kernel)</tt>
+///
+void prefix_popcount(std::span<const word_type> words,
+                     std::span<word_type> out,
+                     popcount_kernel kernel) noexcept;
+
+} // namespace detail
+
 /// \brief Checks if the input integer is a power of two.
 ///
 /// \pre <tt>value > 0</tt>
@@ -1,6 +1,11 @@
 #ifndef BRWT_BIT_VECTOR_H
 #define BRWT_BIT_VECTOR_H
 
+#include "brwt/block_allocator.h"
+#include "brwt/common_types.h"
+#include "brwt/detail/array_storage.h"
+#include "brwt/image.h"
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
@@ -10,30 +15,146 @@
 
 namespace brwt {
 
+/// \brief Fixed-size sequence of bits stored in 64-bit blocks.
+///
+/// Non-empty vectors keep a padding block after their blocks that is always
+/// zero, so a chunk can be read as the funnel shift of two consecutive blocks
+/// without checking whether it straddles them.
+///
 class bit_vector {
 public:
   using size_type = std::ptrdiff_t;
-  using block_type = std::uint_fast64_t;
+  using block_type = word_type;
+
+  /// \brief Allocator of the blocks. Implicitly constructible from an \c
+  /// allocation_policy or a \c std::pmr::memory_resource pointer.
+  using allocator_type = block_allocator<block_type>;
+
+  /// \brief Array of blocks owned by a bit vector.
+  using storage_type = std::vector<block_type, allocator_type>;
 
   static constexpr size_type bits_per_block =
       std::numeric_limits<block_type>::digits;
 
   bit_vector() = default;
-  explicit bit_vector(size_type count);
+  explicit bit_vector(size_type count, const allocator_type& alloc = {});
   explicit bit_vector(size_type count, block_type value);
+
+  /// \brief Constructs a bit vector from a string of '0' and '1' characters.
+  ///
+  /// The last character of \p s is the bit at position zero. The string is
+  /// read 64 characters per step with vector compares.
+  ///
   explicit bit_vector(const std::string& s);
 
+  /// \brief Constructs a bit vector whose i-th bit is <tt>bits[i]</tt>.
+  ///
+  explicit bit_vector(std::span<const bool> bits,
+                      const allocator_type& alloc = {});
+
+  /// \brief Constructs a bit vector with the first \p count bits of a packed
+  /// byte array. Bit \c i is the bit <tt>i % 8</tt> of <tt>bytes[i / 8]</tt>.
+  ///
+  /// \pre <tt>count >= 0 && count <= 8 * bytes.size()</tt>
+  ///
+  bit_vector(std::span<const std::uint8_t> bytes, size_type count,
+             const allocator_type& alloc = {});
+
+  /// \brief Constructs a bit vector of \p count bits that takes ownership of
+  /// the given blocks, without copying them.
+  ///
+  /// The bits of the last block past \p count are cleared. The padding block
+  /// is appended to \p blocks, which only reallocates them if they have no
+  /// spare capacity.
+  ///
+  /// \pre <tt>blocks.size() == ceil_div(count, bits_per_block)</tt>
+  ///
+  bit_vector(size_type count, storage_type blocks);
+
+  /// \brief Returns a bit vector of \p count bits whose blocks are left
+  /// uninitialized, so that they are written once by the caller through \c
+  /// get_mutable_blocks.
+  ///
+  /// Every block must be written before the vector is read, and the bits of
+  /// the last block past \p count must be written as zero. The padding block
+  /// is already zero.
+  ///
+  static bit_vector for_overwrite(size_type count,
+                                  const allocator_type& alloc = {});
+
   size_type length() const noexcept;
   size_type size() const noexcept;
   size_type num_blocks() const noexcept;
   size_type allocated_bytes() const noexcept;
 
+  /// \brief Returns the number of bits that fit in the allocated blocks.
+  ///
+  size_type capacity() const noexcept;
+
+  /// \brief Changes the number of bits to \p count. New bits are zero.
+  ///
+  /// The blocks grow geometrically, so growing by a few bits at a time is
+  /// amortized constant time per bit. Shrinking keeps the capacity.
+  ///
+  /// \pre <tt>count >= 0</tt>
+  ///
+  void resize(size_type count);
+
+  /// \brief Allocates room for at least \p count bits.
+  ///
+  void reserve(size_type count);
+
+  /// \brief Releases the unused capacity.
+  ///
+  void shrink_to_fit();
+
+  /// \brief Returns the policy used to allocate the blocks.
+  ///
+  allocation_policy get_allocation_policy() const noexcept {
+    return m_blocks.get_allocator().policy();
+  }
+
+  /// \brief Returns the allocator of the blocks.
+  ///
+  allocator_type get_allocator() const noexcept {
+    return m_blocks.get_allocator();
+  }
+
   bool get(size_type pos) const noexcept;
   void set(size_type pos, bool value) noexcept;
 
+  /// \brief Returns the \p count bits starting at \p pos.
+  ///
+  /// Always reads the block after the one of \p pos, even if the chunk does
+  /// not straddle it.
+  ///
   block_type get_chunk(size_type pos, size_type count) const noexcept;
+
+  /// \brief Sets the \p count bits starting at \p pos to the lowest bits of
+  /// \p value.
+  ///
+  /// Only writes the blocks that hold the chunk, so chunks that do not share
+  /// a block can be set concurrently.
+  ///
   void set_chunk(size_type pos, size_type count, block_type value) noexcept;
 
+  /// \brief Copies the bits <tt>[src_pos, src_pos + count)</tt> of \p src to
+  /// the positions <tt>[dst_pos, dst_pos + count)</tt> of \c *this.
+  ///
+  /// The ranges may overlap when \p src is \c *this, as in \c std::memmove.
+  /// Each destination block is written at once with a funnel shift of two
+  /// source blocks, so the copy runs at word speed for any pair of offsets.
+  ///
+  /// \pre <tt>count >= 0</tt>
+  /// \pre <tt>src_pos >= 0 && src_pos + count <= src.size()</tt>
+  /// \pre <tt>dst_pos >= 0 && dst_pos + count <= size()</tt>
+  ///
+  /// \par Complexity
+  /// Linear in <tt>count / bits_per_block</tt>.
+  ///
+  void copy_bits(const bit_vector& src, size_type src_pos, size_type dst_pos,
+                 size_type count) noexcept;
+
   block_type get_block(size_type num_block) const noexcept;
   void set_block(size_type num_block, block_type value) noexcept;
 
@@ -42,12 +163,118 @@ public:
   /// Note that the unused bits from the last block are set to zero.
   ///
   std::span<const block_type> get_blocks() const noexcept {
-    return m_blocks;
+    return {m_blocks.data(), static_cast<std::size_t>(num_blocks())};
+  }
+
+  /// \brief Returns a span to the underlying array of blocks, to write them
+  /// in bulk.
+  ///
+  /// The unused bits from the last block must be left as zero.
+  ///
+  std::span<block_type> get_mutable_blocks() noexcept {
+    const auto blocks = m_blocks.mutable_span();
+    return blocks.first(static_cast<std::size_t>(num_blocks()));
+  }
+
+  /// \brief Appends the bit vector to an image.
+  ///
+  /// \see image
+  ///
+  void save(image& img) const;
+
+  /// \brief Returns a bit vector that views the next bit vector saved in the
+  /// image of \p reader.
+  ///
+  /// \throws std::length_error if the image is truncated or corrupted.
+  ///
+  /// \see image
+  ///
+  static bit_vector view(image_reader& reader);
+
+private:
+  void clear_unused_bits() noexcept;
+
+  static constexpr block_type low_mask(const size_type count) noexcept {
+    assert(count > 0 && count <= bits_per_block);
+    return ~block_type{0} >> (bits_per_block - count);
+  }
+
+  size_type m_len{};
+
+  /// The blocks plus the padding block, or nothing if the vector is empty.
+  detail::array_storage<block_type> m_blocks;
+};
+
+/// \brief Builds a \c bit_vector by appending bits at its end.
+///
+/// The last incomplete block is buffered in a single word, so appending a bit
+/// only touches a register until a block is complete. Complete blocks are
+/// appended to an array whose capacity grows geometrically, which makes
+/// appending amortized constant time.
+///
+/// \c build moves the blocks into the resulting \c bit_vector without copying
+/// them. A \c bitmap can be built from the result in the same way, as in
+/// <tt>bitmap(std::move(builder).build())</tt>.
+///
+class bit_vector_builder {
+public:
+  using size_type = bit_vector::size_type;
+  using block_type = bit_vector::block_type;
+
+  static constexpr size_type bits_per_block = bit_vector::bits_per_block;
+
+  bit_vector_builder() = default;
+
+  /// \brief Constructs an empty builder whose blocks are allocated with the
+  /// given allocator.
+  ///
+  explicit bit_vector_builder(const bit_vector::allocator_type& alloc);
+
+  /// \brief Returns the number of appended bits.
+  ///
+  size_type size() const noexcept {
+    return m_len;
   }
 
+  /// \brief Reserves storage for at least \p count bits.
+  ///
+  void reserve(size_type count);
+
+  /// \brief Appends a bit.
+  ///
+  void push_back(bool value);
+
+  /// \brief Appends the \p count least significant bits of \p value, the
+  /// least significant one first.
+  ///
+  /// \pre <tt>count >= 0 && count <= bits_per_block</tt>
+  ///
+  void append_bits(block_type value, size_type count);
+
+  /// \brief Appends \p count bits equal to \p value.
+  ///
+  /// \pre <tt>count >= 0</tt>
+  ///
+  void append(size_type count, bool value);
+
+  /// \brief Returns the bit vector of the appended bits, and leaves the
+  /// builder empty.
+  ///
+  /// The result keeps the storage of the builder, including any spare
+  /// capacity.
+  ///
+  bit_vector build() &&;
+
 private:
+  void flush_block();
+
   size_type m_len{};
-  std::vector<block_type> m_blocks;
+
+  /// Bits of the last, incomplete block. Its bits past m_len are zero.
+  block_type m_buffer{};
+
+  /// Complete blocks.
+  bit_vector::storage_type m_blocks;
 };
 
 // ==========================================
@@ -63,7 +290,48 @@ inline auto bit_vector::size() const noexcept -> size_type {
 }
 
 inline auto bit_vector::num_blocks() const noexcept -> size_type {
-  return static_cast<size_type>(m_blocks.size());
+  return (m_len + bits_per_block - 1) / bits_per_block;
+}
+
+inline auto bit_vector::get_chunk(const size_type pos,
+                                  const size_type count) const noexcept
+    -> block_type {
+  assert(count >= 0 && count <= bits_per_block);
+  assert(pos >= 0 && pos + count <= length());
+  if (count == 0) {
+    return 0;
+  }
+  // The chunk ends before the padding block, so the block after the first one
+  // always exists. The second block is shifted in two steps so that an offset
+  // of zero shifts it out instead of invoking undefined behaviour. Unsigned,
+  // so that the division becomes a shift.
+  const auto idx = static_cast<std::size_t>(pos) / bits_per_block;
+  const auto offset = static_cast<std::size_t>(pos) % bits_per_block;
+  const auto lo = m_blocks[idx] >> offset;
+  const auto hi = (m_blocks[idx + 1] << 1) << (bits_per_block - 1 - offset);
+  return (lo | hi) & low_mask(count);
+}
+
+inline void bit_vector::set_chunk(const size_type pos, const size_type count,
+                                  const block_type value) noexcept {
+  assert(count >= 0 && count <= bits_per_block);
+  assert(pos >= 0 && pos + count <= length());
+  if (count == 0) {
+    return;
+  }
+  // Unlike get_chunk, the second block is only touched if the chunk straddles
+  // it, so chunks that do not share a block can be written concurrently.
+  const auto idx = static_cast<std::size_t>(pos) / bits_per_block;
+  const auto offset = static_cast<std::size_t>(pos) % bits_per_block;
+  const auto mask = low_mask(count);
+  const auto bits = value & mask;
+
+  m_blocks[idx] = (m_blocks[idx] & ~(mask << offset)) | (bits << offset);
+  if (offset + static_cast<std::size_t>(count) > bits_per_block) {
+    const auto rshift = bits_per_block - offset;
+    m_blocks[idx + 1] =
+        (m_blocks[idx + 1] & ~(mask >> rshift)) | (bits >> rshift);
+  }
 }
 
 inline auto bit_vector::get_block(const size_type num_block) const noexcept
@@ -76,6 +344,30 @@ inline void bit_vector::set_block(const size_type num_block,
   m_blocks[num_block] = value;
 }
 
+inline void bit_vector_builder::push_back(const bool value) {
+  m_buffer |= block_type{value} << (m_len % bits_per_block);
+  ++m_len;
+  if (m_len % bits_per_block == 0) {
+    flush_block();
+  }
+}
+
+inline void bit_vector_builder::append_bits(block_type value,
+                                            const size_type count) {
+  assert(count >= 0 && count <= bits_per_block);
+  if (count < bits_per_block) {
+    value &= (block_type{1} << count) - 1;
+  }
+  const auto offset = m_len % bits_per_block;
+  m_buffer |= value << offset;
+  m_len += count;
+  if (offset + count >= bits_per_block) {
+    flush_block();
+    // The bits of value that did not fit in the flushed block.
+    m_buffer = (offset == 0) ? 0 : value >> (bits_per_block - offset);
+  }
+}
+
 } // namespace brwt
 
 #endif // BRWT_BIT_VECTOR_H
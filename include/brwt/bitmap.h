@@ -2,20 +2,69 @@
 #define BRWT_BITMAP_H
 
 #include "brwt/bit_vector.h"
+#include "brwt/block_allocator.h"
 #include "brwt/common_types.h"
-#include "brwt/int_vector.h"
+#include "brwt/detail/array_storage.h"
+#include "brwt/detail/iterator.h"
+#include "brwt/detail/rank_directory.h"
+#include "brwt/image.h"
+#include "brwt/rank_layout.h"
+#include <array>
 #include <cassert>
+#include <ranges>
+#include <span>
+#include <utility>
 
 namespace brwt {
 
-class bitmap {
+/// \brief Construction options of \c basic_bitmap.
+///
+struct bitmap_options {
+  /// \brief Number of bits equal to one (and to zero) between consecutive
+  /// select samples.
+  ///
+  /// Each sample takes one word and narrows the super block search of \c
+  /// select_1 (or \c select_0) to the super blocks between two consecutive
+  /// samples. Smaller values speed up select at the cost of more memory. Zero
+  /// disables the samples.
+  ///
+  size_type select_sample_rate = 4096;
+
+  /// \brief Number of threads used to build the rank directory.
+  ///
+  /// Zero uses one thread per hardware thread. Bitmaps too small to benefit
+  /// from more threads are built sequentially. The result does not depend on
+  /// this value.
+  ///
+  int num_threads = 1;
+};
+
+/// \brief Bit sequence with rank and select support.
+///
+/// \tparam Layout A \c rank_layout that selects the space and speed trade-off
+/// of the rank directory. The library provides every valid \c rank_layout
+/// with 4, 8, 16 or 32 blocks per super block.
+///
+template <typename Layout>
+class basic_bitmap {
 public:
   using index_type = brwt::index_type;
   using size_type = brwt::size_type;
+  using layout_type = Layout;
+
+  /// \brief Forward iterator over the positions of the bits equal to one.
+  using one_iterator = detail::bit_position_iterator<true>;
+
+  /// \brief Forward iterator over the positions of the bits equal to zero.
+  using zero_iterator = detail::bit_position_iterator<false>;
 
 public:
-  bitmap() noexcept = default;
-  explicit bitmap(bit_vector vec);
+  basic_bitmap() noexcept = default;
+
+  /// \throws std::length_error if \c Layout uses \c bits32 counters and \p vec
+  /// has 2<sup>32</sup> bits or more.
+  ///
+  explicit basic_bitmap(bit_vector vec, bitmap_options options = {});
 
   bool access(index_type pos) const noexcept;
 
@@ -25,63 +74,305 @@ public:
   index_type select_0(size_type nth) const noexcept;
   index_type select_1(size_type nth) const noexcept;
 
+  /// \brief Counts the bits equal to zero before each end of the range
+  /// <tt>[first, last)</tt>.
+  ///
+  /// \see rank_1(index_type, index_type)
+  ///
+  std::pair<size_type, size_type> rank_0(index_type first,
+                                         index_type last) const noexcept;
+
+  /// \brief Counts the bits equal to one before each end of the range
+  /// <tt>[first, last)</tt>.
+  ///
+  /// Returns <tt>{rank_1(first - 1), rank_1(last - 1)}</tt>, where
+  /// <tt>rank_1(-1)</tt> is zero. When both ends fall in the same super block,
+  /// its directory entry is read once and the count of the second end
+  /// continues from the first one.
+  ///
+  /// \pre <tt>first >= 0 && first <= last && last <= size()</tt>
+  ///
+  std::pair<size_type, size_type> rank_1(index_type first,
+                                         index_type last) const noexcept;
+
+  /// \name Batched queries
+  ///
+  /// Each function answers <tt>out[i] = f(queries[i])</tt> for every \c i. The
+  /// queries are independent, so the directory and data loads of the following
+  /// queries are prefetched while the current ones are answered. This hides
+  /// most of the memory latency when the bitmap does not fit in cache.
+  ///
+  /// \pre <tt>queries.size() == out.size()</tt>
+  /// @{
+
+  void rank_1(std::span<const index_type> positions,
+              std::span<size_type> out) const noexcept;
+
+  void select_0(std::span<const size_type> nths,
+                std::span<index_type> out) const noexcept;
+  void select_1(std::span<const size_type> nths,
+                std::span<index_type> out) const noexcept;
+
+  /// @}
+
+  /// \name Bitwise operations
+  ///
+  /// Each function returns the bitmap whose bits are the given bitwise
+  /// operation of the bits of \c *this and \p other, built with \p options.
+  /// The result is built in a single pass: each tile of result blocks is
+  /// counted for the rank directory while it is still in cache, so the
+  /// operands are read once and the result is written once.
+  ///
+  /// The result uses the allocation policy of \c *this.
+  ///
+  /// \pre <tt>size() == other.size()</tt>
+  /// @{
+
+  basic_bitmap bit_and(const basic_bitmap& other,
+                       bitmap_options options = {}) const;
+  basic_bitmap bit_or(const basic_bitmap& other,
+                      bitmap_options options = {}) const;
+  basic_bitmap bit_xor(const basic_bitmap& other,
+                       bitmap_options options = {}) const;
+
+  /// \brief Computes <tt>*this & ~other</tt>.
+  ///
+  basic_bitmap bit_andnot(const basic_bitmap& other,
+                          bitmap_options options = {}) const;
+
+  /// @}
+
+  /// \brief Finds the first bit equal to zero at or after the given position.
+  ///
+  /// The rest of the super block containing \p pos is scanned word by word
+  /// before falling back to the directory.
+  ///
+  /// \pre <tt>pos >= 0 && pos <= size()</tt>
+  ///
+  /// \returns The position of the bit if it exists. Otherwise returns
+  /// <tt>-1</tt>.
+  ///
+  index_type select_next_0(index_type pos) const noexcept;
+
+  /// \brief Finds the first bit equal to one at or after the given position.
+  ///
+  /// \see select_next_0
+  ///
+  index_type select_next_1(index_type pos) const noexcept;
+
+  /// \name Enumeration
+  ///
+  /// These functions visit the positions of the bits equal to one (or zero) in
+  /// the range <tt>[first, last)</tt> in increasing order. The bit sequence is
+  /// read word by word, so listing \e k positions costs linear time in \e k
+  /// plus the number of words of the range. Calling \c select for each
+  /// position instead costs logarithmic time per position.
+  ///
+  /// \pre <tt>first >= 0 && first <= last && last <= size()</tt>
+  /// @{
+
+  /// \brief Calls \p f with the position of each bit equal to one in
+  /// <tt>[first, last)</tt>.
+  ///
+  template <typename Function>
+  void for_each_one(index_type first, index_type last, Function f) const;
+
+  /// \brief Calls \p f with the position of each bit equal to zero in
+  /// <tt>[first, last)</tt>.
+  ///
+  template <typename Function>
+  void for_each_zero(index_type first, index_type last, Function f) const;
+
+  /// \brief Returns the positions of the bits equal to one in <tt>[first,
+  /// last)</tt> as a range of \c one_iterator.
+  ///
+  std::ranges::subrange<one_iterator> ones(index_type first,
+                                           index_type last) const noexcept;
+
+  /// \brief Returns the positions of the bits equal to zero in <tt>[first,
+  /// last)</tt> as a range of \c zero_iterator.
+  ///
+  std::ranges::subrange<zero_iterator> zeros(index_type first,
+                                             index_type last) const noexcept;
+
+  /// @}
+
   size_type length() const noexcept; // TODO(Diego): Remove this.
   size_type size() const noexcept;
 
   size_type num_ones() const noexcept;
   size_type num_zeros() const noexcept;
 
+  /// \brief Returns the number of allocated bytes, including the rank and
+  /// select directories.
+  ///
+  size_type allocated_bytes() const noexcept;
+
+  /// \brief Appends the bitmap and its directories to an image.
+  ///
+  /// \see image
+  ///
+  void save(image& img) const;
+
+  /// \brief Returns a bitmap that views the next bitmap saved in the image of
+  /// \p reader. Its directories are not rebuilt.
+  ///
+  /// \throws std::length_error if the image is truncated or corrupted.
+  ///
+  /// \see image
+  ///
+  static basic_bitmap view(image_reader& reader);
+
 private:
+  static constexpr size_type blocks_per_super_block =
+      Layout::blocks_per_super_block;
+  static constexpr size_type bits_per_super_block =
+      blocks_per_super_block * bit_vector::bits_per_block;
+
   auto blocks_of_super_block(index_type sb_idx) const noexcept;
   size_type num_super_blocks() const noexcept;
 
+  template <typename Function>
+  void build_directories(bitmap_options options, Function fill_tile);
+
+  template <typename Function>
+  word_type build_rank_entries(index_type sb_first, index_type sb_last,
+                               Function fill_tile) noexcept;
+
+  template <typename Operation>
+  basic_bitmap combine(const basic_bitmap& other, Operation op,
+                       bitmap_options options) const;
+
   template <bool B>
   size_type num_of() const noexcept;
 
   template <bool B>
-  size_type sb_rank(index_type sb_idx) const noexcept;
+  size_type sb_exclusive_rank(index_type sb_idx) const noexcept;
 
   template <bool B>
-  size_type sb_exclusive_rank(index_type sb_idx) const noexcept;
+  size_type block_exclusive_rank(index_type sb_idx,
+                                 index_type block_idx) const noexcept;
+
+  size_type ones_before(index_type pos) const noexcept;
+  size_type ones_in_block_before(index_type pos) const noexcept;
+
+  template <bool B>
+  void build_select_samples(size_type sample_rate);
+
+  template <bool B>
+  std::pair<index_type, index_type>
+  sb_select_range(size_type nth) const noexcept;
 
   template <bool B>
   index_type sb_select(size_type nth) const noexcept;
 
+  template <bool B>
+  index_type select_in_super_block(index_type sb_idx,
+                                   size_type nth) const noexcept;
+
   template <bool B>
   index_type select(size_type nth) const noexcept;
 
+  template <bool B>
+  void select(std::span<const size_type> nths,
+              std::span<index_type> out) const noexcept;
+
+  void prefetch_super_block(index_type sb_idx) const noexcept;
+
+  template <bool B>
+  index_type select_next(index_type pos) const noexcept;
+
   /// Original bit sequence.
   bit_vector bit_seq;
 
-  /// Number of set bits until the i-th super block (included).
-  int_vector sb_rank_1;
+  /// Rank directory. Holds one entry per super block plus a sentinel entry
+  /// whose absolute rank is the total number of set bits.
+  detail::rank_directory<Layout> rank_dir;
+
+  /// Number of bits equal to B between consecutive select samples.
+  size_type select_sample_rate{};
+
+  using sample_array = detail::array_storage<index_type>;
+
+  /// The i-th element of <tt>select_samples[B]</tt> is the super block that
+  /// contains the <tt>(i * select_sample_rate + 1)</tt>-th bit equal to B.
+  std::array<sample_array, 2> select_samples;
 };
 
+/// \brief Bitmap with the default rank directory layout.
+///
+using bitmap = basic_bitmap<rank9_layout>;
+
 // ==========================================
 // Inline definitions
 // ==========================================
 
-inline auto bitmap::access(const index_type pos) const noexcept -> bool {
+template <typename Layout>
+inline auto basic_bitmap<Layout>::access(const index_type pos) const noexcept
+    -> bool {
   return bit_seq.get(pos);
 }
 
-inline auto bitmap::length() const noexcept -> size_type {
+template <typename Layout>
+template <typename Function>
+void basic_bitmap<Layout>::for_each_one(const index_type first,
+                                        const index_type last,
+                                        Function f) const {
+  assert(first >= 0 && first <= last && last <= size());
+  detail::for_each_bit_equal_to<true>(bit_seq.get_blocks(), first, last,
+                                      std::move(f));
+}
+
+template <typename Layout>
+template <typename Function>
+void basic_bitmap<Layout>::for_each_zero(const index_type first,
+                                         const index_type last,
+                                         Function f) const {
+  assert(first >= 0 && first <= last && last <= size());
+  detail::for_each_bit_equal_to<false>(bit_seq.get_blocks(), first, last,
+                                       std::move(f));
+}
+
+template <typename Layout>
+inline auto basic_bitmap<Layout>::ones(const index_type first,
+                                       const index_type last) const noexcept
+    -> std::ranges::subrange<one_iterator> {
+  assert(first >= 0 && first <= last && last <= size());
+  const auto blocks = bit_seq.get_blocks();
+  return {one_iterator(blocks, first, last), one_iterator(blocks, last, last)};
+}
+
+template <typename Layout>
+inline auto basic_bitmap<Layout>::zeros(const index_type first,
+                                        const index_type last) const noexcept
+    -> std::ranges::subrange<zero_iterator> {
+  assert(first >= 0 && first <= last && last <= size());
+  const auto blocks = bit_seq.get_blocks();
+  return {zero_iterator(blocks, first, last),
+          zero_iterator(blocks, last, last)};
+}
+
+template <typename Layout>
+inline auto basic_bitmap<Layout>::length() const noexcept -> size_type {
   return bit_seq.length();
 }
 
-inline auto bitmap::size() const noexcept -> size_type {
+template <typename Layout>
+inline auto basic_bitmap<Layout>::size() const noexcept -> size_type {
   return bit_seq.length();
 }
 
-inline auto bitmap::num_ones() const noexcept -> size_type {
+template <typename Layout>
+inline auto basic_bitmap<Layout>::num_ones() const noexcept -> size_type {
   if (size() == 0) {
     return 0;
   }
-  assert(!sb_rank_1.empty());
-  return static_cast<size_type>(sb_rank_1.back());
+  assert(rank_dir.size() > 0);
+  return static_cast<size_type>(rank_dir.abs_rank(rank_dir.size() - 1));
 }
 
-inline auto bitmap::num_zeros() const noexcept -> size_type {
+template <typename Layout>
+inline auto basic_bitmap<Layout>::num_zeros() const noexcept -> size_type {
   return size() - num_ones();
 }
 
@@ -0,0 +1,146 @@
+#ifndef BRWT_BLOCK_ALLOCATOR_H
+#define BRWT_BLOCK_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+namespace brwt {
+
+/// \brief Specifies how the storage of the succinct structures is allocated.
+///
+enum class allocation_policy {
+  /// Cache line aligned memory from the global operator new.
+  aligned,
+
+  /// Cache line aligned memory backed by huge pages when it is large enough.
+  ///
+  /// Large allocations first try explicit huge pages (\c MAP_HUGETLB). If none
+  /// are reserved, they fall back to regular pages advised as transparent huge
+  /// pages (\c MADV_HUGEPAGE), which the kernel may or may not honor. On other
+  /// platforms, this policy behaves as \c aligned.
+  huge_pages,
+};
+
+/// Alignment of the memory returned by \c block_allocator.
+inline constexpr std::size_t block_alignment = 64;
+
+namespace detail {
+
+void* allocate_blocks(std::size_t bytes, allocation_policy policy);
+void deallocate_blocks(void* ptr, std::size_t bytes,
+                       allocation_policy policy) noexcept;
+
+template <typename T>
+class array_storage;
+
+} // namespace detail
+
+/// \brief Allocator that follows an \c allocation_policy, or that draws from
+/// a \c std::pmr::memory_resource.
+///
+/// The policy and the resource are part of the allocator state and propagate
+/// with the container on copy, move and swap, so the storage of a structure
+/// keeps its policy wherever it goes. With a resource, every structure built
+/// from the same input allocates from it, so a whole structure can live in a
+/// \c std::pmr::monotonic_buffer_resource and be released at once. The
+/// resource must outlive the structures that use it.
+///
+template <typename T>
+class block_allocator {
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  static_assert(alignof(T) <= block_alignment);
+
+public:
+  block_allocator() noexcept = default;
+
+  block_allocator(const allocation_policy policy) noexcept // NOLINT
+      : m_policy{policy} {}
+
+  /// \brief Constructs an allocator that draws from \p resource, or that
+  /// follows the \c aligned policy if \p resource is null.
+  ///
+  block_allocator(std::pmr::memory_resource* const resource) noexcept // NOLINT
+      : m_resource{resource} {}
+
+  template <typename U>
+  block_allocator(const block_allocator<U>& other) noexcept // NOLINT
+      : m_policy{other.policy()}, m_resource{other.resource()} {}
+
+  T* allocate(const std::size_t count) {
+    if (count > static_cast<std::size_t>(-1) / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    if (m_resource != nullptr) {
+      return static_cast<T*>(
+          m_resource->allocate(count * sizeof(T), block_alignment));
+    }
+    return static_cast<T*>(
+        detail::allocate_blocks(count * sizeof(T), m_policy));
+  }
+
+  void deallocate(T* const ptr, const std::size_t count) noexcept {
+    if (m_resource != nullptr) {
+      m_resource->deallocate(ptr, count * sizeof(T), block_alignment);
+      return;
+    }
+    detail::deallocate_blocks(ptr, count * sizeof(T), m_policy);
+  }
+
+  /// \brief Constructs the element at \p ptr without a value. It is
+  /// value-initialized, as by \c std::allocator, unless the allocator is used
+  /// by \c detail::array_storage::resize_for_overwrite.
+  ///
+  template <typename U>
+  void construct(U* const ptr) noexcept(
+      std::is_nothrow_default_constructible_v<U>) {
+    if (m_for_overwrite) {
+      ::new (static_cast<void*>(ptr)) U;
+    } else {
+      ::new (static_cast<void*>(ptr)) U();
+    }
+  }
+
+  allocation_policy policy() const noexcept {
+    return m_policy;
+  }
+
+  /// \brief Returns the memory resource, or \c nullptr if the allocator
+  /// follows its policy instead.
+  ///
+  std::pmr::memory_resource* resource() const noexcept {
+    return m_resource;
+  }
+
+  friend bool operator==(const block_allocator& lhs,
+                         const block_allocator& rhs) noexcept {
+    return lhs.policy() == rhs.policy() && lhs.resource() == rhs.resource();
+  }
+
+private:
+  template <typename>
+  friend class detail::array_storage;
+
+  /// Returns a copy that leaves the elements constructed without a value
+  /// uninitialized. Copies from other element types do not inherit it, and
+  /// it does not take part in equality.
+  block_allocator for_overwrite() const noexcept {
+    auto result = *this;
+    result.m_for_overwrite = true;
+    return result;
+  }
+
+  allocation_policy m_policy = allocation_policy::aligned;
+  std::pmr::memory_resource* m_resource = nullptr;
+  bool m_for_overwrite = false;
+};
+
+} // namespace brwt
+
+#endif // BRWT_BLOCK_ALLOCATOR_H
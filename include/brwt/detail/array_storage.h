@@ -0,0 +1,200 @@
+#ifndef BRWT_DETAIL_ARRAY_STORAGE_H
+#define BRWT_DETAIL_ARRAY_STORAGE_H
+
+#include "brwt/block_allocator.h"
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace brwt::detail {
+
+/// \brief Array that either owns its elements or views elements owned by
+/// someone else, such as a memory mapped file.
+///
+/// Reads go through a cached pointer to the elements, so they cost the same in
+/// both modes. Only owning arrays can be modified. Copies of a view are views
+/// of the same elements.
+///
+template <typename T>
+class array_storage {
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using vector_type = std::vector<T, block_allocator<T>>;
+  using allocator_type = block_allocator<T>;
+
+  array_storage() = default;
+
+  explicit array_storage(const allocator_type& alloc) : m_vec(alloc) {}
+
+  array_storage(vector_type vec) noexcept // NOLINT
+      : m_vec(std::move(vec)), m_data{m_vec.data()}, m_size{m_vec.size()} {}
+
+  array_storage(const std::size_t count, const allocator_type& alloc)
+      : array_storage(vector_type(count, alloc)) {}
+
+  /// \brief Returns an array that views the given elements.
+  ///
+  static array_storage view(const std::span<const T> elems) noexcept {
+    array_storage result;
+    result.m_data = elems.data();
+    result.m_size = elems.size();
+    result.m_is_view = true;
+    return result;
+  }
+
+  array_storage(const array_storage& other)
+      : m_vec(other.m_vec), m_is_view{other.m_is_view} {
+    sync(other);
+  }
+
+  array_storage(array_storage&& other) noexcept
+      : m_vec(std::move(other.m_vec)), m_is_view{other.m_is_view} {
+    sync(other);
+    other.reset();
+  }
+
+  array_storage& operator=(const array_storage& other) {
+    if (this != &other) {
+      m_vec = other.m_vec;
+      m_is_view = other.m_is_view;
+      sync(other);
+    }
+    return *this;
+  }
+
+  array_storage& operator=(array_storage&& other) noexcept {
+    if (this != &other) {
+      m_vec = std::move(other.m_vec);
+      m_is_view = other.m_is_view;
+      sync(other);
+      other.reset();
+    }
+    return *this;
+  }
+
+  ~array_storage() = default;
+
+  bool is_view() const noexcept {
+    return m_is_view;
+  }
+
+  std::size_t size() const noexcept {
+    return m_size;
+  }
+
+  bool empty() const noexcept {
+    return m_size == 0;
+  }
+
+  /// \brief Returns the capacity of the owned elements, or zero if this is a
+  /// view.
+  ///
+  std::size_t capacity() const noexcept {
+    return m_vec.capacity();
+  }
+
+  allocator_type get_allocator() const noexcept {
+    return m_vec.get_allocator();
+  }
+
+  const T* data() const noexcept {
+    return m_data;
+  }
+
+  const T& operator[](const std::size_t idx) const noexcept {
+    assert(idx < m_size);
+    return m_data[idx];
+  }
+
+  T& operator[](const std::size_t idx) noexcept {
+    assert(!m_is_view && idx < m_size);
+    return m_vec[idx];
+  }
+
+  /// \brief Returns the owned elements for writing.
+  ///
+  std::span<T> mutable_span() noexcept {
+    assert(!m_is_view);
+    return m_vec;
+  }
+
+  const T& back() const noexcept {
+    assert(m_size > 0);
+    return m_data[m_size - 1];
+  }
+
+  operator std::span<const T>() const noexcept { // NOLINT
+    return {m_data, m_size};
+  }
+
+  // Modifiers of owning arrays.
+
+  void reserve(const std::size_t count) {
+    modify([&] { m_vec.reserve(count); });
+  }
+
+  void resize(const std::size_t count) {
+    modify([&] { m_vec.resize(count); });
+  }
+
+  /// \brief Resizes the array, leaving the new elements uninitialized.
+  ///
+  void resize_for_overwrite(const std::size_t count) {
+    modify([&] {
+      // The buffer moves between allocators that compare equal, so it is not
+      // copied. Only the temporary one skips the initialization; the array
+      // keeps an allocator that value-initializes.
+      const auto alloc = m_vec.get_allocator();
+      vector_type vec(std::move(m_vec), alloc.for_overwrite());
+      vec.resize(count);
+      m_vec = vector_type(std::move(vec), alloc);
+    });
+  }
+
+  void push_back(const T& value) {
+    modify([&] { m_vec.push_back(value); });
+  }
+
+  void clear() noexcept {
+    modify([&] { m_vec.clear(); });
+  }
+
+  void shrink_to_fit() {
+    modify([&] { m_vec.shrink_to_fit(); });
+  }
+
+private:
+  template <typename Function>
+  void modify(Function f) {
+    assert(!m_is_view);
+    f();
+    m_data = m_vec.data();
+    m_size = m_vec.size();
+  }
+
+  /// Points to the elements of this array after copying or moving the state of
+  /// other.
+  void sync(const array_storage& other) noexcept {
+    m_data = m_is_view ? other.m_data : m_vec.data();
+    m_size = m_is_view ? other.m_size : m_vec.size();
+  }
+
+  void reset() noexcept {
+    m_vec.clear();
+    m_data = m_vec.data();
+    m_size = 0;
+    m_is_view = false;
+  }
+
+  vector_type m_vec;
+  const T* m_data{};
+  std::size_t m_size{};
+  bool m_is_view = false;
+};
+
+} // namespace brwt::detail
+
+#endif // BRWT_DETAIL_ARRAY_STORAGE_H
@@ -0,0 +1,108 @@
+#ifndef BRWT_DETAIL_BIT_PACKING_H
+#define BRWT_DETAIL_BIT_PACKING_H
+
+#include "brwt/bit_ops.h"
+#include "brwt/bit_vector.h"
+#include "brwt/common_types.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+namespace brwt::detail {
+
+// Kernels that pack and unpack arrays of integers of a fixed number of bits,
+// stored one after another in the blocks of a bit_vector.
+
+using packed_value_type = bit_vector::block_type;
+
+constexpr int bits_per_packed_block =
+    std::numeric_limits<packed_value_type>::digits;
+
+/// A group of this many elements starting at a multiple of it occupies exactly
+/// `bpe` whole blocks.
+constexpr size_type elems_per_group = bits_per_packed_block;
+
+/// Returns the J-th element of the group of elements of `Bpe` bits stored at
+/// `blocks`.
+template <int Bpe, std::size_t J>
+packed_value_type unpack_one(const packed_value_type* const blocks) noexcept {
+  constexpr auto pos = J * Bpe;
+  constexpr auto idx = pos / bits_per_packed_block;
+  constexpr auto shift = pos % bits_per_packed_block;
+  constexpr auto mask = lsb_mask<packed_value_type>(Bpe);
+
+  if constexpr (shift + Bpe <= bits_per_packed_block) {
+    return (blocks[idx] >> shift) & mask;
+  } else {
+    const auto hi = blocks[idx + 1] << (bits_per_packed_block - shift);
+    return ((blocks[idx] >> shift) | hi) & mask;
+  }
+}
+
+/// Adds `value` as the J-th element of the group of elements of `Bpe` bits
+/// stored at `blocks`.
+template <int Bpe, std::size_t J>
+void pack_one(packed_value_type* const blocks,
+              const packed_value_type value) noexcept {
+  constexpr auto pos = J * Bpe;
+  constexpr auto idx = pos / bits_per_packed_block;
+  constexpr auto shift = pos % bits_per_packed_block;
+
+  blocks[idx] |= value << shift;
+  if constexpr (shift + Bpe > bits_per_packed_block) {
+    blocks[idx + 1] |= value >> (bits_per_packed_block - shift);
+  }
+}
+
+/// Unpacks `num_groups` groups of elements of `Bpe` bits. The elements of a
+/// group are expanded at compile time, so every shift and mask is a constant.
+template <int Bpe>
+void unpack_groups(const packed_value_type* blocks, packed_value_type* out,
+                   const size_type num_groups) noexcept {
+  for (size_type g = 0; g < num_groups; ++g) {
+    [&]<std::size_t... J>(std::index_sequence<J...>) {
+      ((out[J] = unpack_one<Bpe, J>(blocks)), ...);
+    }(std::make_index_sequence<elems_per_group>{});
+    blocks += Bpe;
+    out += elems_per_group;
+  }
+}
+
+/// Packs `num_groups` groups of elements of `Bpe` bits into the blocks of
+/// `bits` that start at `first_block`.
+template <int Bpe>
+void pack_groups(const packed_value_type* values, bit_vector& bits,
+                 size_type first_block, const size_type num_groups) noexcept {
+  for (size_type g = 0; g < num_groups; ++g) {
+    std::array<packed_value_type, Bpe> group{};
+    [&]<std::size_t... J>(std::index_sequence<J...>) {
+      (pack_one<Bpe, J>(group.data(), values[J]), ...);
+    }(std::make_index_sequence<elems_per_group>{});
+    for (const auto block : group) {
+      bits.set_block(first_block++, block);
+    }
+    values += elems_per_group;
+  }
+}
+
+/// Splits the elements <tt>[first, first + count)</tt> in the elements before
+/// the first group boundary, the whole groups, and the remaining elements.
+struct group_split {
+  size_type head;
+  size_type num_groups;
+  size_type tail;
+};
+
+constexpr group_split split_groups(const size_type first,
+                                   const size_type count) noexcept {
+  const auto head = std::min(
+      count, (elems_per_group - first % elems_per_group) % elems_per_group);
+  const auto num_groups = (count - head) / elems_per_group;
+  return {head, num_groups, count - head - num_groups * elems_per_group};
+}
+
+} // namespace brwt::detail
+
+#endif // BRWT_DETAIL_BIT_PACKING_H
@@ -1,10 +1,14 @@
 #ifndef BRWT_DETAIL_ITERATOR_H
 #define BRWT_DETAIL_ITERATOR_H
 
+#include "brwt/common_types.h"
 #include "brwt/detail/utility.h"
+#include <bit>
 #include <cassert>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <span>
 #include <type_traits>
 
 namespace brwt::detail {
@@ -152,6 +156,157 @@ private:
   difference_type m_pos{};
 };
 
+/// \brief Returns the block \p idx of \p blocks with a one at each bit equal
+/// to \c B whose position lies in <tt>[first, last)</tt>, and a zero
+/// elsewhere.
+///
+/// \pre <tt>first < last</tt> and block \p idx overlaps <tt>[first,
+/// last)</tt>.
+///
+template <bool B>
+word_type bits_equal_to(const std::span<const word_type> blocks,
+                        const index_type idx, const index_type first,
+                        const index_type last) noexcept {
+  constexpr index_type bits_per_block = std::numeric_limits<word_type>::digits;
+  assert(first < last);
+  assert(idx >= first / bits_per_block && idx <= (last - 1) / bits_per_block);
+
+  auto word = blocks[static_cast<std::size_t>(idx)];
+  if constexpr (!B) {
+    word = ~word;
+  }
+  if (idx == first / bits_per_block) {
+    word &= ~word_type{0} << (first % bits_per_block);
+  }
+  if (idx == (last - 1) / bits_per_block) {
+    word &= ~word_type{0} >> (bits_per_block - 1 - (last - 1) % bits_per_block);
+  }
+  return word;
+}
+
+/// \brief Calls \p f with the position of each bit equal to \c B in
+/// <tt>[first, last)</tt>, in increasing order.
+///
+/// Each block is loaded once, and its bits are extracted by counting trailing
+/// zeros and clearing the lowest set bit.
+///
+/// \par Complexity
+/// Linear in the number of blocks overlapping the range plus the number of
+/// calls to \p f.
+///
+template <bool B, typename Function>
+void for_each_bit_equal_to(const std::span<const word_type> blocks,
+                           const index_type first, const index_type last,
+                           Function f) {
+  constexpr index_type bits_per_block = std::numeric_limits<word_type>::digits;
+  if (first >= last) {
+    return;
+  }
+  const auto block_last = (last - 1) / bits_per_block;
+  for (auto idx = first / bits_per_block; idx <= block_last; ++idx) {
+    auto word = bits_equal_to<B>(blocks, idx, first, last);
+    for (; word != 0; word &= word - 1) {
+      f(idx * bits_per_block + std::countr_zero(word));
+    }
+  }
+}
+
+/// \brief Forward iterator over the positions of the bits equal to \c B in a
+/// range of a block sequence.
+///
+/// Two iterators can be compared if and only if they refer to the same range.
+/// The past-the-end iterator of a range <tt>[first, last)</tt> is the one
+/// constructed from <tt>[last, last)</tt>.
+///
+/// \par Complexity
+/// Incrementing the iterator is amortized constant, plus the number of blocks
+/// skipped because they have no bit equal to \c B.
+///
+template <bool B>
+class bit_position_iterator {
+public:
+  // public types
+
+  using value_type = index_type;
+  using reference = index_type;
+  using pointer = void;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+
+  // constructors
+
+  constexpr bit_position_iterator() = default;
+
+  /// \brief Constructs an iterator to the first bit equal to \c B in
+  /// <tt>[first, last)</tt>.
+  ///
+  bit_position_iterator(const std::span<const word_type> blocks,
+                        const index_type first, const index_type last) noexcept
+      : m_blocks{blocks}, m_block{first / bits_per_block}, m_last{last} {
+    if (first >= last) {
+      m_pos = last;
+      return;
+    }
+    m_word = bits_equal_to<B>(m_blocks, m_block, first, last);
+    seek();
+  }
+
+  // element access
+
+  reference operator*() const noexcept {
+    assert(m_pos < m_last);
+    return m_pos;
+  }
+
+  // modifiers
+
+  bit_position_iterator& operator++() noexcept {
+    assert(m_word != 0);
+    m_word &= m_word - 1;
+    seek();
+    return *this;
+  }
+  bit_position_iterator operator++(int) noexcept {
+    auto old = *this;
+    ++(*this);
+    return old;
+  }
+
+  // relational operators
+
+  friend bool operator==(const bit_position_iterator& lhs,
+                         const bit_position_iterator& rhs) noexcept {
+    return lhs.m_pos == rhs.m_pos;
+  }
+
+private:
+  static constexpr index_type bits_per_block =
+      std::numeric_limits<word_type>::digits;
+
+  /// Moves to the lowest bit of m_word, loading the next blocks while m_word is
+  /// zero. Stops at m_last if there are no more bits.
+  void seek() noexcept {
+    const auto block_last = (m_last - 1) / bits_per_block;
+    while (m_word == 0) {
+      if (m_block == block_last) {
+        m_pos = m_last;
+        return;
+      }
+      ++m_block;
+      m_word = bits_equal_to<B>(m_blocks, m_block, m_block * bits_per_block,
+                                m_last);
+    }
+    m_pos = m_block * bits_per_block + std::countr_zero(m_word);
+  }
+
+  // member data
+  std::span<const word_type> m_blocks;
+  index_type m_block{};
+  word_type m_word{};
+  index_type m_pos{};
+  index_type m_last{};
+};
+
 } // namespace brwt::detail
 
 #endif // BRWT_DETAIL_ITERATOR_H
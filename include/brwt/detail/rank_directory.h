@@ -0,0 +1,275 @@
+#ifndef BRWT_DETAIL_RANK_DIRECTORY_H
+#define BRWT_DETAIL_RANK_DIRECTORY_H
+
+#include "brwt/bit_ops.h"
+#include "brwt/block_allocator.h"
+#include "brwt/common_types.h"
+#include "brwt/detail/array_storage.h"
+#include "brwt/image.h"
+#include "brwt/int_vector.h"
+#include "brwt/rank_layout.h"
+#include "brwt/utility.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+namespace brwt::detail {
+
+/// \brief Storage of the counters of a rank directory, as described by a
+/// \c rank_layout.
+///
+/// Holds one absolute counter per super block plus a sentinel, and the block
+/// counters of each super block if the layout has them.
+///
+/// With \c relative16 and \c relative32 counters, each window of
+/// <tt>entries_per_window</tt> entries also has a 64-bit upper counter, and
+/// the entries only store their rank relative to the start of the window.
+///
+template <typename Layout>
+class rank_directory {
+  static constexpr bool is_packed = Layout::width == counter_width::packed;
+  static constexpr bool is_relative =
+      Layout::width == counter_width::relative16 ||
+      Layout::width == counter_width::relative32;
+
+  static constexpr int window_bits_log2 =
+      Layout::width == counter_width::relative16 ? 16 : 32;
+
+  using counter_type = std::conditional_t<
+      Layout::width == counter_width::relative16, std::uint16_t,
+      std::conditional_t<Layout::width == counter_width::bits32 ||
+                             Layout::width == counter_width::relative32,
+                         std::uint32_t, std::uint64_t>>;
+
+  struct entry {
+    counter_type abs_rank;
+    word_type rel_ranks;
+  };
+
+  template <typename T>
+  using array_type = array_storage<T>;
+
+  using storage_type = std::conditional_t<
+      Layout::block_counters, array_type<entry>,
+      std::conditional_t<is_packed, int_vector, array_type<counter_type>>>;
+
+public:
+  /// \brief Number of consecutive entries that share an upper counter. One
+  /// when there are no upper counters.
+  ///
+  static constexpr size_type entries_per_window =
+      is_relative ? (size_type{1} << window_bits_log2) /
+                        (Layout::blocks_per_super_block *
+                         std::numeric_limits<word_type>::digits)
+                  : 1;
+
+  /// \brief Alignment of the ranges of entries that can be written
+  /// concurrently.
+  ///
+  /// Ranges of entries that start at a multiple of this value, and end at one
+  /// or at the last entry, share no word of memory: 64 packed counters take
+  /// exactly as many whole words as their bit width, and the entries of a
+  /// window share their upper counter. Hence, \c set_abs_rank and
+  /// \c add_to_abs_ranks can be called concurrently on such ranges.
+  ///
+  static constexpr size_type concurrent_alignment =
+      is_packed ? std::numeric_limits<word_type>::digits : entries_per_window;
+
+  rank_directory() = default;
+
+  /// \brief Constructs a zeroed directory of \p count entries that can store
+  /// counters up to \p max_rank.
+  ///
+  /// \throws std::length_error if \p max_rank does not fit in the counters.
+  ///
+  rank_directory(const size_type count, const size_type max_rank,
+                 const block_allocator<word_type>& alloc) {
+    if (!is_relative && static_cast<std::uint64_t>(max_rank) >
+                            std::numeric_limits<counter_type>::max()) {
+      throw std::length_error("bitmap: Too many bits for the rank counters");
+    }
+    if constexpr (is_relative) {
+      m_upper = array_type<std::uint64_t>(
+          static_cast<std::size_t>(ceil_div(count, entries_per_window)),
+          alloc);
+    }
+    if constexpr (is_packed) {
+      const auto bpe = std::max(1, used_bits(static_cast<word_type>(max_rank)));
+      m_entries = int_vector(count, bpe, alloc);
+    } else {
+      m_entries = storage_type(static_cast<std::size_t>(count), alloc);
+    }
+  }
+
+  size_type size() const noexcept {
+    return static_cast<size_type>(m_entries.size());
+  }
+
+  word_type abs_rank(const index_type idx) const noexcept {
+    if constexpr (Layout::block_counters) {
+      return m_entries[static_cast<std::size_t>(idx)].abs_rank;
+    } else if constexpr (is_relative) {
+      return m_upper[window_of(idx)] + m_entries[static_cast<std::size_t>(idx)];
+    } else {
+      return m_entries[idx];
+    }
+  }
+
+  /// \brief Sets the absolute counter of the given entry.
+  ///
+  /// \pre The entries of a window are set in increasing order, starting with
+  /// the first one of the window.
+  ///
+  /// Only writes the words that hold the entry and, for the first entry of a
+  /// window, its upper counter. Packed entries rely on
+  /// \c bit_vector::set_chunk not touching the neighbouring words.
+  ///
+  /// \see concurrent_alignment
+  ///
+  void set_abs_rank(const index_type idx, const word_type value) noexcept {
+    if constexpr (Layout::block_counters) {
+      m_entries[static_cast<std::size_t>(idx)].abs_rank =
+          static_cast<counter_type>(value);
+    } else if constexpr (is_relative) {
+      const auto window = window_of(idx);
+      if (idx % entries_per_window == 0) {
+        m_upper[window] = value;
+      }
+      m_entries[static_cast<std::size_t>(idx)] =
+          static_cast<counter_type>(value - m_upper[window]);
+    } else {
+      m_entries[idx] = static_cast<counter_type>(value);
+    }
+  }
+
+  /// \brief Adds \p delta to the absolute counters of the entries in
+  /// <tt>[first, last)</tt>.
+  ///
+  /// \pre \p first is a multiple of \c entries_per_window, and so is \p last
+  /// unless it is the last entry.
+  ///
+  /// If \p first and \p last are also multiples of \c concurrent_alignment,
+  /// only the words of the entries in the range are read and written.
+  ///
+  void add_to_abs_ranks(const index_type first, const index_type last,
+                        const word_type delta) noexcept {
+    assert(first % entries_per_window == 0);
+    if constexpr (is_relative) {
+      const auto window_last = ceil_div(last, entries_per_window);
+      for (auto w = first / entries_per_window; w < window_last; ++w) {
+        m_upper[static_cast<std::size_t>(w)] += delta;
+      }
+    } else if constexpr (is_packed) {
+      // The bulk functions process whole groups of 64 entries as whole words.
+      // Reading the entries one by one would also read the word after each of
+      // them, which may belong to another range.
+      std::array<word_type, 256> buffer;
+      for (auto i = first; i < last; i += std::ssize(buffer)) {
+        const auto batch = std::span(buffer).first(static_cast<std::size_t>(
+            std::min(last - i, std::ssize(buffer))));
+        m_entries.decode(i, batch);
+        for (auto& value : batch) {
+          value += delta;
+        }
+        m_entries.encode(i, batch);
+      }
+    } else {
+      for (auto i = first; i < last; ++i) {
+        set_abs_rank(i, abs_rank(i) + delta);
+      }
+    }
+  }
+
+  word_type rel_ranks(const index_type idx) const noexcept
+    requires Layout::block_counters
+  {
+    return m_entries[static_cast<std::size_t>(idx)].rel_ranks;
+  }
+
+  void set_rel_ranks(const index_type idx, const word_type value) noexcept
+    requires Layout::block_counters
+  {
+    m_entries[static_cast<std::size_t>(idx)].rel_ranks = value;
+  }
+
+  /// \brief Returns the address of the given entry, or \c nullptr if the
+  /// entries are not addressable.
+  ///
+  const void* address_of(const index_type idx) const noexcept {
+    if constexpr (is_packed) {
+      static_cast<void>(idx);
+      return nullptr;
+    } else {
+      return &m_entries[static_cast<std::size_t>(idx)];
+    }
+  }
+
+  size_type allocated_bytes() const noexcept {
+    auto bytes =
+        static_cast<size_type>(m_upper.capacity() * sizeof(std::uint64_t));
+    if constexpr (is_packed) {
+      bytes += m_entries.allocated_bytes();
+    } else {
+      using value_type = typename storage_type::value_type;
+      bytes +=
+          static_cast<size_type>(m_entries.capacity() * sizeof(value_type));
+    }
+    return bytes;
+  }
+
+  /// \brief Appends the directory to an image.
+  ///
+  void save(image& img) const {
+    if constexpr (is_packed) {
+      m_entries.save(img);
+    } else {
+      using value_type = typename storage_type::value_type;
+      save_array<value_type>(img, m_entries);
+    }
+    save_array<std::uint64_t>(img, m_upper);
+  }
+
+  /// \brief Returns a directory that views the next directory saved in the
+  /// image of \p reader.
+  ///
+  static rank_directory view(image_reader& reader) {
+    rank_directory result;
+    if constexpr (is_packed) {
+      result.m_entries = int_vector::view(reader);
+    } else {
+      using value_type = typename storage_type::value_type;
+      result.m_entries = view_array<value_type>(reader);
+    }
+    result.m_upper = view_array<std::uint64_t>(reader);
+
+    const auto num_windows = ceil_div(result.size(), entries_per_window);
+    if (is_relative &&
+        static_cast<size_type>(result.m_upper.size()) != num_windows) {
+      throw std::length_error("image: Corrupted rank directory");
+    }
+    return result;
+  }
+
+private:
+  static std::size_t window_of(const index_type idx) noexcept {
+    // Unsigned, so that the division becomes a shift.
+    return static_cast<std::size_t>(idx) /
+           static_cast<std::size_t>(entries_per_window);
+  }
+
+  storage_type m_entries;
+
+  /// Absolute rank of the first entry of each window. Empty unless the
+  /// counters are relative.
+  array_type<std::uint64_t> m_upper;
+};
+
+} // namespace brwt::detail
+
+#endif // BRWT_DETAIL_RANK_DIRECTORY_H
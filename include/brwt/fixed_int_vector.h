@@ -0,0 +1,412 @@
+#ifndef BRWT_FIXED_INT_VECTOR_H
+#define BRWT_FIXED_INT_VECTOR_H
+
+#include "brwt/bit_ops.h"
+#include "brwt/bit_vector.h"
+#include "brwt/block_allocator.h"
+#include "brwt/common_types.h"
+#include "brwt/detail/bit_packing.h"
+#include "brwt/detail/iterator.h"
+#include "brwt/image.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+namespace brwt {
+
+/// \brief Fixed-size array of integers of \p Bits bits each.
+///
+/// This class offers the interface of \c int_vector and stores its elements
+/// with the same layout, but the number of bits per element is a template
+/// argument instead of a member. Hence, the position of an element is computed
+/// with a constant multiplier, its mask is a constant, and the bulk functions
+/// call the packing kernel of \p Bits directly.
+///
+/// Images saved by an \c int_vector of \p Bits bits per element can be viewed
+/// as a \c fixed_int_vector<Bits>, and vice versa.
+///
+/// \tparam Bits The number of bits per element, between 1 and 63.
+///
+template <int Bits>
+class fixed_int_vector {
+  static_assert(Bits >= 1 && Bits < bit_vector::bits_per_block);
+
+public:
+  using value_type = bit_vector::block_type;
+  using size_type = bit_vector::size_type;
+  using difference_type = std::ptrdiff_t;
+  using allocator_type = bit_vector::allocator_type;
+
+  static constexpr int bits_per_element = Bits;
+
+  /// \brief Class to provide an l-value reference to a particular element from
+  /// the array.
+  class reference {
+  private:
+    reference(fixed_int_vector& vec, size_type pos) noexcept
+        : vector{vec}, elem_pos{pos} {}
+
+  public:
+    reference(const reference&) = default;
+    ~reference() = default;
+
+    reference& operator=(const value_type value) noexcept {
+      vector.set_value(elem_pos, value);
+      return *this;
+    }
+    reference& operator=(const reference& other) noexcept {
+      vector.set_value(elem_pos, other);
+      return *this;
+    }
+    operator value_type() const noexcept { // NOLINT
+      return vector.get_value(elem_pos);
+    }
+
+    /// \brief Swaps the values of the elements that \p lhs and \p rhs are
+    /// referring to.
+    ///
+    friend void swap(reference lhs, reference rhs) noexcept {
+      const value_type tmp = lhs;
+      lhs = rhs;
+      rhs = tmp;
+    }
+    friend void swap(reference lhs, value_type& rhs) noexcept {
+      const value_type tmp = lhs;
+      lhs = rhs;
+      rhs = tmp;
+    }
+    friend void swap(value_type& lhs, reference rhs) noexcept {
+      const value_type tmp = lhs;
+      lhs = rhs;
+      rhs = tmp;
+    }
+
+  private:
+    fixed_int_vector& vector;
+    size_type elem_pos;
+    friend fixed_int_vector;
+  };
+
+  using const_reference = value_type;
+
+  using iterator =
+      detail::random_access_iterator<fixed_int_vector, value_type, reference,
+                                     difference_type>;
+
+  using const_iterator =
+      detail::random_access_iterator<const fixed_int_vector, value_type,
+                                     const_reference, difference_type>;
+
+public:
+  /// \brief Constructs an empty vector.
+  ///
+  fixed_int_vector() = default;
+
+  /// \brief Constructs a vector of \p count zeroed elements.
+  ///
+  /// \par Time complexity
+  /// Linear in <tt>count * Bits</tt>.
+  ///
+  explicit fixed_int_vector(const size_type count,
+                            const allocator_type& alloc = {})
+      : bit_seq(count * Bits, alloc), num_elems{count} {
+    assert(count >= 0);
+  }
+
+  /// \brief Constructs the sequence with the given initializer list.
+  ///
+  /// \pre Every element of \p ilist fits in \p Bits bits.
+  ///
+  fixed_int_vector(const std::initializer_list<value_type> ilist)
+      : fixed_int_vector(static_cast<size_type>(ilist.size())) {
+    encode(0, {ilist.begin(), ilist.size()});
+  }
+
+  /// \name Element access
+  /// @{
+
+  reference operator[](const size_type pos) noexcept {
+    return reference(*this, pos);
+  }
+
+  const_reference operator[](const size_type pos) const noexcept {
+    return get_value(pos);
+  }
+
+  reference front() noexcept {
+    assert(!empty());
+    return reference(*this, 0);
+  }
+
+  const_reference front() const noexcept {
+    assert(!empty());
+    return get_value(0);
+  }
+
+  reference back() noexcept {
+    assert(!empty());
+    return reference(*this, size() - 1);
+  }
+
+  const_reference back() const noexcept {
+    assert(!empty());
+    return get_value(size() - 1);
+  }
+
+  /// @}
+
+  /// \name Bulk access
+  ///
+  /// \see int_vector::decode
+  /// @{
+
+  void decode(const size_type first,
+              const std::span<value_type> out) const noexcept {
+    const auto count = std::ssize(out);
+    assert(first >= 0 && first + count <= size());
+
+    const auto split = detail::split_groups(first, count);
+    auto* dst = out.data();
+    auto pos = first;
+    for (size_type i = 0; i < split.head; ++i) {
+      *dst++ = get_value(pos++);
+    }
+    detail::unpack_groups<Bits>(
+        bit_seq.get_blocks().data() + pos / detail::elems_per_group * Bits,
+        dst, split.num_groups);
+    dst += split.num_groups * detail::elems_per_group;
+    pos += split.num_groups * detail::elems_per_group;
+    for (size_type i = 0; i < split.tail; ++i) {
+      *dst++ = get_value(pos++);
+    }
+  }
+
+  void encode(const size_type first,
+              const std::span<const value_type> values) noexcept {
+    const auto count = std::ssize(values);
+    assert(first >= 0 && first + count <= size());
+
+    const auto split = detail::split_groups(first, count);
+    const auto* src = values.data();
+    auto pos = first;
+    for (size_type i = 0; i < split.head; ++i) {
+      set_value(pos++, *src++);
+    }
+    detail::pack_groups<Bits>(src, bit_seq,
+                              pos / detail::elems_per_group * Bits,
+                              split.num_groups);
+    src += split.num_groups * detail::elems_per_group;
+    pos += split.num_groups * detail::elems_per_group;
+    for (size_type i = 0; i < split.tail; ++i) {
+      set_value(pos++, *src++);
+    }
+  }
+
+  /// @}
+
+  /// \name Capacity
+  /// @{
+
+  size_type size() const noexcept {
+    return num_elems;
+  }
+
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  static constexpr size_type get_bpe() noexcept {
+    return Bits;
+  }
+
+  size_type capacity() const noexcept {
+    return bit_seq.capacity() / Bits;
+  }
+
+  size_type allocated_bytes() const noexcept {
+    return bit_seq.allocated_bytes();
+  }
+
+  allocation_policy get_allocation_policy() const noexcept {
+    return bit_seq.get_allocation_policy();
+  }
+
+  allocator_type get_allocator() const noexcept {
+    return bit_seq.get_allocator();
+  }
+
+  /// @}
+
+  /// \name Images
+  /// @{
+
+  /// \brief Appends the vector to an image, in the format of \c int_vector.
+  ///
+  /// \see image
+  ///
+  void save(image& img) const {
+    img.push_back(static_cast<word_type>(num_elems));
+    img.push_back(static_cast<word_type>(Bits));
+    bit_seq.save(img);
+  }
+
+  /// \brief Returns a vector that views the next vector saved in the image of
+  /// \p reader. The result cannot be modified.
+  ///
+  /// \throws std::length_error if the image is truncated, corrupted, or holds
+  /// a vector with other number of bits per element.
+  ///
+  /// \see image
+  ///
+  static fixed_int_vector view(image_reader& reader) {
+    fixed_int_vector result;
+    result.num_elems = static_cast<size_type>(reader.read_word());
+    const auto bpe = reader.read_word();
+    result.bit_seq = bit_vector::view(reader);
+
+    if (result.num_elems < 0 || bpe != Bits ||
+        result.bit_seq.size() != result.num_elems * Bits) {
+      throw std::length_error("image: Corrupted fixed int vector");
+    }
+    return result;
+  }
+
+  /// @}
+
+  /// \name Iterators
+  /// @{
+
+  iterator begin() noexcept {
+    return iterator(*this, 0);
+  }
+  const_iterator begin() const noexcept {
+    return const_iterator(*this, 0);
+  }
+  const_iterator cbegin() const noexcept {
+    return const_iterator(*this, 0);
+  }
+
+  iterator end() noexcept {
+    return iterator(*this, size());
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(*this, size());
+  }
+  const_iterator cend() const noexcept {
+    return const_iterator(*this, size());
+  }
+
+  /// @}
+
+  /// \name Modifiers
+  /// @{
+
+  void clear() noexcept {
+    bit_seq.resize(0);
+    num_elems = 0;
+  }
+
+  /// \brief Appends an element at the end.
+  ///
+  /// \see int_vector::push_back
+  ///
+  void push_back(const value_type value) {
+    bit_seq.resize((num_elems + 1) * Bits);
+    ++num_elems;
+    set_value(num_elems - 1, value);
+  }
+
+  void reserve(const size_type count) {
+    bit_seq.reserve(count * Bits);
+  }
+
+  /// \brief Changes the number of elements to \p count. New elements are
+  /// zero.
+  ///
+  void resize(const size_type count) {
+    assert(count >= 0);
+    bit_seq.resize(count * Bits);
+    num_elems = count;
+  }
+
+  void shrink_to_fit() {
+    bit_seq.shrink_to_fit();
+  }
+
+  iterator erase(const const_iterator pos) noexcept {
+    assert(pos >= begin() && pos < end());
+    return erase(pos, pos + 1);
+  }
+
+  /// \brief Removes the elements in the range <tt>[first, last)</tt>.
+  ///
+  /// \see int_vector::erase
+  ///
+  iterator erase(const const_iterator first,
+                 const const_iterator last) noexcept {
+    assert(first >= begin() && first <= last && last <= end());
+
+    const auto first_idx = first - cbegin();
+    const auto last_idx = last - cbegin();
+    bit_seq.copy_bits(bit_seq, last_idx * Bits, first_idx * Bits,
+                      (num_elems - last_idx) * Bits);
+    num_elems -= last_idx - first_idx;
+    bit_seq.resize(num_elems * Bits);
+
+    return begin() + first_idx;
+  }
+
+  void swap(fixed_int_vector& other) noexcept {
+    using std::swap;
+    swap(bit_seq, other.bit_seq);
+    swap(num_elems, other.num_elems);
+  }
+
+  /// @}
+
+  /// \brief Compares \p lhs and \p rhs for equality.
+  ///
+  friend bool operator==(const fixed_int_vector& lhs,
+                         const fixed_int_vector& rhs) noexcept {
+    if (lhs.size() != rhs.size()) {
+      return false;
+    }
+    // Compare the used bits a block at a time.
+    const auto num_bits = lhs.size() * Bits;
+    const auto full_blocks = num_bits / bit_vector::bits_per_block;
+    const auto rest = num_bits % bit_vector::bits_per_block;
+    const auto lhs_blocks = lhs.bit_seq.get_blocks();
+    const auto rhs_blocks = rhs.bit_seq.get_blocks();
+    return std::equal(lhs_blocks.begin(), lhs_blocks.begin() + full_blocks,
+                      rhs_blocks.begin()) &&
+           lhs.bit_seq.get_chunk(num_bits - rest, rest) ==
+               rhs.bit_seq.get_chunk(num_bits - rest, rest);
+  }
+
+  friend void swap(fixed_int_vector& lhs, fixed_int_vector& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+private:
+  value_type get_value(const size_type pos) const noexcept {
+    assert(pos >= 0 && pos < num_elems && "Out of range");
+    return bit_seq.get_chunk(pos * Bits, Bits);
+  }
+
+  void set_value(const size_type pos, const value_type value) noexcept {
+    assert(pos >= 0 && pos < num_elems && "Out of range");
+    assert(value <= lsb_mask<value_type>(Bits));
+    bit_seq.set_chunk(pos * Bits, Bits, value);
+  }
+
+  bit_vector bit_seq;
+  size_type num_elems{};
+};
+
+} // namespace brwt
+
+#endif // BRWT_FIXED_INT_VECTOR_H
@@ -0,0 +1,111 @@
+#ifndef BRWT_IMAGE_H
+#define BRWT_IMAGE_H
+
+#include "brwt/common_types.h"
+#include "brwt/detail/array_storage.h"
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace brwt {
+
+/// \brief Flat array of 64-bit words that holds saved structures.
+///
+/// Each structure has a \c save member function that appends it to an image,
+/// and a static \c view member function that reads it back from an image. The
+/// structures returned by \c view do not copy their data: they run their
+/// queries directly on the words of the image, which can live in a memory
+/// mapped file or in shared memory. Such views cannot be modified, and the
+/// image must outlive them and their copies.
+///
+/// Images use the byte order of the machine and are only meant to be read by
+/// the same version of the library that wrote them.
+///
+using image = std::vector<word_type>;
+
+/// \brief Reads the words of an image in order.
+///
+class image_reader {
+public:
+  explicit image_reader(const std::span<const word_type> words) noexcept
+      : m_words{words} {}
+
+  /// \brief Returns the number of words not read yet.
+  ///
+  size_type remaining() const noexcept {
+    return static_cast<size_type>(m_words.size());
+  }
+
+  /// \brief Reads one word.
+  ///
+  /// \throws std::length_error if the image has no words left.
+  ///
+  word_type read_word() {
+    return read_words(1)[0];
+  }
+
+  /// \brief Reads the next \p count words.
+  ///
+  /// \throws std::length_error if the image has less than \p count words left.
+  ///
+  std::span<const word_type> read_words(const size_type count) {
+    if (count < 0 || count > remaining()) {
+      throw std::length_error("image: Unexpected end of the image");
+    }
+    const auto result = m_words.first(static_cast<std::size_t>(count));
+    m_words = m_words.subspan(static_cast<std::size_t>(count));
+    return result;
+  }
+
+private:
+  std::span<const word_type> m_words;
+};
+
+namespace detail {
+
+/// \brief Appends the size and the elements of an array to \p img, padding the
+/// elements to a whole number of words.
+///
+template <typename T>
+void save_array(image& img, const std::span<const T> elems) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(alignof(T) <= alignof(word_type));
+
+  constexpr auto word_size = sizeof(word_type);
+  const auto num_bytes = elems.size() * sizeof(T);
+  img.push_back(static_cast<word_type>(elems.size()));
+
+  const auto first = img.size();
+  img.resize(first + (num_bytes + word_size - 1) / word_size);
+  if (num_bytes > 0) {
+    std::memcpy(img.data() + first, elems.data(), num_bytes);
+  }
+}
+
+/// \brief Reads an array written by \c save_array, and returns a view of its
+/// elements.
+///
+template <typename T>
+array_storage<T> view_array(image_reader& reader) {
+  constexpr auto word_size = sizeof(word_type);
+  const auto count = reader.read_word();
+  if (count > static_cast<word_type>(reader.remaining()) * word_size) {
+    throw std::length_error("image: Unexpected end of the image");
+  }
+  const auto num_bytes = static_cast<std::size_t>(count) * sizeof(T);
+  const auto words = reader.read_words(
+      static_cast<size_type>((num_bytes + word_size - 1) / word_size));
+
+  // The image holds a copy of the bytes of the elements.
+  const auto* const elems = reinterpret_cast<const T*>(words.data()); // NOLINT
+  return array_storage<T>::view({elems, static_cast<std::size_t>(count)});
+}
+
+} // namespace detail
+
+} // namespace brwt
+
+#endif // BRWT_IMAGE_H
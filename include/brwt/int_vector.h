@@ -2,11 +2,14 @@
 #define BRWT_INT_VECTOR_H
 
 #include "brwt/bit_vector.h"
+#include "brwt/block_allocator.h"
 #include "brwt/detail/iterator.h"
+#include "brwt/image.h"
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <initializer_list>
+#include <span>
 
 namespace brwt {
 
@@ -15,6 +18,7 @@ public:
   using value_type = bit_vector::block_type;
   using size_type = bit_vector::size_type;
   using difference_type = std::ptrdiff_t;
+  using allocator_type = bit_vector::allocator_type;
 
   /// \brief Class to provide an l-value reference to a particular element from
   /// the array.
@@ -68,6 +72,7 @@ public:
   ///
   /// \param count The number of elements to store.
   /// \param bpe The number of bits per element to use.
+  /// \param alloc The allocator of the storage.
   ///
   /// \par Time complexity
   /// Linear in <tt>count * bpe</tt>.
@@ -75,7 +80,7 @@ public:
   /// \throws std::domain_error if \p bits is greater than or equal to the
   /// number of bits of <tt>value_type</tt>.
   ///
-  int_vector(size_type count, int bpe);
+  int_vector(size_type count, int bpe, const allocator_type& alloc = {});
 
   /// \brief Constructs the sequence with the given initializer list.
   ///
@@ -152,6 +157,36 @@ public:
 
   /// @}
 
+  /// \name Bulk access
+  ///
+  /// These functions copy runs of elements between the vector and plain
+  /// arrays. A group of 64 consecutive elements, starting at a multiple of 64,
+  /// occupies exactly <tt>get_bpe()</tt> blocks, so each group is unpacked or
+  /// packed by a kernel specialized for the number of bits per element, whose
+  /// shifts and masks are all constants. Going through the iterators instead
+  /// reads or writes one chunk per element.
+  ///
+  /// \par Time complexity
+  /// Linear in the number of copied elements.
+  /// @{
+
+  /// \brief Copies the elements <tt>[first, first + out.size())</tt> to \p
+  /// out.
+  ///
+  /// \pre <tt>first >= 0 && first + out.size() <= size()</tt>
+  ///
+  void decode(size_type first, std::span<value_type> out) const noexcept;
+
+  /// \brief Assigns \p values to the elements <tt>[first, first +
+  /// values.size())</tt>.
+  ///
+  /// \pre <tt>first >= 0 && first + values.size() <= size()</tt>
+  /// \pre Every value fits in <tt>get_bpe()</tt> bits.
+  ///
+  void encode(size_type first, std::span<const value_type> values) noexcept;
+
+  /// @}
+
   /// \name Capacity
   /// @{
 
@@ -179,6 +214,13 @@ public:
     return bits_per_element;
   }
 
+  /// \brief Returns the number of elements that fit in the allocated storage.
+  ///
+  /// If \c get_bpe() is zero, the elements take no storage, and the result is
+  /// the maximum value of \c size_type.
+  ///
+  size_type capacity() const noexcept;
+
   /// \brief Returns the number of allocated bytes.
   ///
   /// \par Time complexity
@@ -188,6 +230,38 @@ public:
     return bit_seq.allocated_bytes();
   }
 
+  /// \brief Returns the policy used to allocate the storage.
+  ///
+  allocation_policy get_allocation_policy() const noexcept {
+    return bit_seq.get_allocation_policy();
+  }
+
+  /// \brief Returns the allocator of the storage.
+  ///
+  allocator_type get_allocator() const noexcept {
+    return bit_seq.get_allocator();
+  }
+
+  /// @}
+
+  /// \name Images
+  /// @{
+
+  /// \brief Appends the vector to an image.
+  ///
+  /// \see image
+  ///
+  void save(image& img) const;
+
+  /// \brief Returns a vector that views the next vector saved in the image of
+  /// \p reader. The result cannot be modified.
+  ///
+  /// \throws std::length_error if the image is truncated or corrupted.
+  ///
+  /// \see image
+  ///
+  static int_vector view(image_reader& reader);
+
   /// @}
 
   /// \name Iterators
@@ -224,11 +298,37 @@ public:
   /// Constant.
   ///
   void clear() noexcept {
-    // bit_seq is leaved as is.
+    // The capacity of bit_seq is kept.
+    bit_seq.resize(0);
     num_elems = 0;
     bits_per_element = 0;
   }
 
+  /// \brief Appends an element at the end.
+  ///
+  /// \pre \p value fits in <tt>get_bpe()</tt> bits.
+  ///
+  /// \par Time complexity
+  /// Amortized constant. The storage grows geometrically.
+  ///
+  void push_back(value_type value);
+
+  /// \brief Allocates room for at least \p count elements.
+  ///
+  void reserve(size_type count);
+
+  /// \brief Changes the number of elements to \p count. New elements are
+  /// zero.
+  ///
+  /// \par Time complexity
+  /// Linear in the number of added elements.
+  ///
+  void resize(size_type count);
+
+  /// \brief Releases the unused capacity.
+  ///
+  void shrink_to_fit();
+
   /// \brief Removes the element at \p pos.
   ///
   /// \pre The iterator \p pos must be valid and dereferenceable.
@@ -271,6 +371,9 @@ private:
   size_type index_of(const_iterator pos) const noexcept;
   iterator non_const(const_iterator pos) noexcept;
 
+  friend bool operator==(const int_vector& lhs,
+                         const int_vector& rhs) noexcept;
+
 private:
   bit_vector bit_seq;
   size_type num_elems{};
@@ -296,10 +399,7 @@ inline void swap(int_vector& lhs, int_vector& rhs) noexcept {
 ///
 /// \relates int_vector
 ///
-inline bool operator==(const int_vector& lhs, const int_vector& rhs) {
-  return lhs.size() == rhs.size() &&
-         std::equal(lhs.begin(), lhs.end(), rhs.begin());
-}
+bool operator==(const int_vector& lhs, const int_vector& rhs) noexcept;
 
 /// \brief Swaps the values of the elements that \p lhs and \p rhs are referring
 /// to.
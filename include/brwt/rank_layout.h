@@ -0,0 +1,74 @@
+#ifndef BRWT_RANK_LAYOUT_H
+#define BRWT_RANK_LAYOUT_H
+
+#include "brwt/common_types.h"
+
+namespace brwt {
+
+/// \brief Representation of the cumulative counters of a rank directory.
+///
+enum class counter_width {
+  /// Bit-packed counters of <tt>used_bits(size)</tt> bits each. The smallest
+  /// option, but every read is a shift-and-mask that may straddle two words.
+  packed,
+
+  /// 32-bit counters. Limited to bitmaps with less than 2<sup>32</sup> set
+  /// bits.
+  bits32,
+
+  /// 64-bit counters.
+  bits64,
+
+  /// 16-bit counters relative to a 64-bit counter stored every 2<sup>16</sup>
+  /// bits. Reading a counter adds the two, the upper one being almost always
+  /// in cache.
+  relative16,
+
+  /// 32-bit counters relative to a 64-bit counter stored every 2<sup>32</sup>
+  /// bits. Unlike \c bits32, it has no size limit.
+  relative32,
+};
+
+/// \brief Compile-time description of the rank directory of \c basic_bitmap.
+///
+/// \tparam BlocksPerSuperBlock Number of 64-bit blocks covered by each
+/// absolute counter. Must be 4, 8, 16 or 32.
+///
+/// \tparam Width Representation of the absolute counters.
+///
+/// \tparam BlockCounters Whether each super block also stores the number of
+/// set bits before each of its blocks, packed in a word interleaved with the
+/// absolute counter. Without them, rank and select popcount the preceding
+/// blocks of the super block. Requires at most 8 blocks per super block and
+/// \c bits32 or \c bits64 counters.
+///
+/// The directory takes <tt>counter_bits / (64 * BlocksPerSuperBlock)</tt>
+/// extra bits per bit, plus 64 more per super block if \p BlockCounters is
+/// set. The upper counters of the relative widths are negligible.
+///
+template <int BlocksPerSuperBlock, counter_width Width, bool BlockCounters>
+struct rank_layout {
+  static_assert(BlocksPerSuperBlock == 4 || BlocksPerSuperBlock == 8 ||
+                BlocksPerSuperBlock == 16 || BlocksPerSuperBlock == 32);
+  static_assert(!BlockCounters ||
+                (BlocksPerSuperBlock <= 8 && (Width == counter_width::bits32 ||
+                                              Width == counter_width::bits64)));
+
+  static constexpr size_type blocks_per_super_block = BlocksPerSuperBlock;
+  static constexpr counter_width width = Width;
+  static constexpr bool block_counters = BlockCounters;
+};
+
+/// \brief 64-bit absolute counters interleaved with 9-bit block counters every
+/// 512 bits (rank9). Costs 25% extra space and answers rank with a single
+/// directory cache line. This is the default layout of \c bitmap.
+///
+using rank9_layout = rank_layout<8, counter_width::bits64, true>;
+
+/// \brief Bit-packed absolute counters every 512 bits, with no block counters.
+///
+using packed_layout = rank_layout<8, counter_width::packed, false>;
+
+} // namespace brwt
+
+#endif // BRWT_RANK_LAYOUT_H
@@ -0,0 +1,111 @@
+#ifndef BRWT_RRR_BITMAP_H
+#define BRWT_RRR_BITMAP_H
+
+#include "brwt/bit_vector.h"
+#include "brwt/common_types.h"
+#include "brwt/int_vector.h"
+
+namespace brwt {
+
+/// \brief Compressed bitmap with the same query interface as \c bitmap.
+///
+/// The bit sequence is split into blocks of \c bits_per_block bits. Each block
+/// is stored as its \e class (the number of set bits) and its \e offset (the
+/// index of the block among all the blocks of the same class). Blocks of class
+/// zero or \c bits_per_block use no offset bits at all, so the total space
+/// approaches the zero-order entropy of the sequence plus the (fixed) cost of
+/// the classes and the super block samples.
+///
+/// Each query locates its super block through the samples, then walks the
+/// classes of at most <tt>blocks_per_super_block - 1</tt> blocks and decodes
+/// the target block with a table lookup.
+///
+class rrr_bitmap {
+public:
+  using index_type = brwt::index_type;
+  using size_type = brwt::size_type;
+
+  /// Number of bits per encoded block.
+  static constexpr int bits_per_block = 15;
+
+  /// Number of blocks between super block samples.
+  static constexpr size_type blocks_per_super_block = 32;
+
+public:
+  /// \brief Constructs an empty bitmap.
+  ///
+  rrr_bitmap() noexcept = default;
+
+  /// \brief Constructs a compressed bitmap from the given bit sequence.
+  ///
+  /// \par Time complexity
+  /// Linear in <tt>vec.size()</tt>.
+  ///
+  explicit rrr_bitmap(const bit_vector& vec);
+
+  bool access(index_type pos) const noexcept;
+
+  size_type rank_0(index_type pos) const noexcept;
+  size_type rank_1(index_type pos) const noexcept;
+
+  index_type select_0(size_type nth) const noexcept;
+  index_type select_1(size_type nth) const noexcept;
+
+  size_type size() const noexcept {
+    return m_size;
+  }
+
+  size_type num_ones() const noexcept {
+    return m_num_ones;
+  }
+
+  size_type num_zeros() const noexcept {
+    return size() - num_ones();
+  }
+
+  /// \brief Returns the number of allocated bytes.
+  ///
+  size_type allocated_bytes() const noexcept;
+
+private:
+  struct block_position {
+    index_type block_idx;  // Index of the block.
+    size_type rank;        // Number of set bits before the block.
+    index_type offset_pos; // Position of the block offset in m_offsets.
+  };
+
+  size_type num_blocks() const noexcept {
+    return m_classes.size();
+  }
+
+  block_position locate(index_type block_idx) const noexcept;
+  word_type decode(const block_position& block) const noexcept;
+
+  template <bool B>
+  size_type sb_exclusive_rank(index_type sb_idx) const noexcept;
+
+  template <bool B>
+  index_type select(size_type nth) const noexcept;
+
+  /// Number of bits of the original sequence.
+  size_type m_size{};
+
+  /// Number of set bits of the original sequence.
+  size_type m_num_ones{};
+
+  /// Number of set bits of each block.
+  int_vector m_classes;
+
+  /// Concatenation of the block offsets.
+  bit_vector m_offsets;
+
+  /// Number of set bits before each super block.
+  int_vector m_sb_rank;
+
+  /// Position in m_offsets of the first offset of each super block.
+  int_vector m_sb_offset;
+};
+
+} // namespace brwt
+
+#endif // BRWT_RRR_BITMAP_H
@@ -0,0 +1,125 @@
+#ifndef BRWT_SPARSE_BITMAP_H
+#define BRWT_SPARSE_BITMAP_H
+
+#include "brwt/bit_vector.h"
+#include "brwt/bitmap.h"
+#include "brwt/common_types.h"
+#include "brwt/image.h"
+#include "brwt/int_vector.h"
+
+namespace brwt {
+
+/// \brief Elias-Fano encoded bitmap, suited for sequences with few set bits.
+///
+/// The positions of the set bits are split into their \c low_bits least
+/// significant bits, stored verbatim in an \c int_vector, and their remaining
+/// high bits, stored in unary as gaps in a \c bitmap. Given \e n set bits among
+/// \e u bits, the space is about <tt>n * (2 + log(u / n))</tt> bits.
+///
+/// \c select_1 costs one select on the high bits plus one read of the low
+/// bits. \c rank and \c access cost one \c select_0 plus a scan of the bucket
+/// that shares the high bits of the query. \c select_0 walks the set bits
+/// between the two samples of the zeros that enclose the query, after
+/// narrowing long runs of set bits down with a binary search. The zeros are
+/// sampled so that about 32 set bits separate two samples, which adds about
+/// <tt>log(n) / 32</tt> bits per set bit.
+///
+/// If the encoding would take more space than the sequence itself, which
+/// happens when more than about a fifth of the bits are set, the sequence is
+/// stored as a plain \c bitmap instead, and the queries are forwarded to it.
+///
+class sparse_bitmap {
+public:
+  using index_type = brwt::index_type;
+  using size_type = brwt::size_type;
+
+public:
+  /// \brief Constructs an empty bitmap.
+  ///
+  sparse_bitmap() noexcept = default;
+
+  /// \brief Constructs an Elias-Fano bitmap from the given bit sequence.
+  ///
+  /// The bitmap allocates its storage with the allocator of \p vec.
+  ///
+  /// \par Time complexity
+  /// Linear in <tt>vec.size()</tt>.
+  ///
+  explicit sparse_bitmap(const bit_vector& vec);
+
+  bool access(index_type pos) const noexcept;
+
+  size_type rank_0(index_type pos) const noexcept;
+  size_type rank_1(index_type pos) const noexcept;
+
+  index_type select_0(size_type nth) const noexcept;
+  index_type select_1(size_type nth) const noexcept;
+
+  size_type size() const noexcept {
+    return m_size;
+  }
+
+  size_type num_ones() const noexcept {
+    return m_num_ones;
+  }
+
+  size_type num_zeros() const noexcept {
+    return size() - num_ones();
+  }
+
+  /// \brief Returns the number of allocated bytes.
+  ///
+  size_type allocated_bytes() const noexcept;
+
+  /// \brief Appends the bitmap to an image.
+  ///
+  /// \see image
+  ///
+  void save(image& img) const;
+
+  /// \brief Returns a bitmap that views the next sparse bitmap saved in the
+  /// image of \p reader.
+  ///
+  /// \throws std::length_error if the image is truncated or corrupted.
+  ///
+  /// \see image
+  ///
+  static sparse_bitmap view(image_reader& reader);
+
+private:
+  void build_zero_samples(const bit_vector& vec);
+
+  word_type low_part(index_type idx) const noexcept;
+  index_type position_of(index_type idx) const noexcept;
+  size_type count_less(index_type pos) const noexcept;
+
+  /// Number of bits of the original sequence.
+  size_type m_size{};
+
+  /// Number of set bits of the original sequence.
+  size_type m_num_ones{};
+
+  /// The sequence is too dense for the encoding, so m_high holds it verbatim.
+  bool m_plain{};
+
+  /// Number of low bits stored explicitly per set bit.
+  int m_low_bits{};
+
+  /// Base 2 logarithm of the number of zeros per sample of m_zero_samples.
+  int m_zero_sample_log2{};
+
+  /// The j-th entry is the number of set bits before the
+  /// <tt>(j << m_zero_sample_log2) + 1</tt>-th zero.
+  int_vector m_zero_samples;
+
+  /// Low bits of each position. Empty when m_low_bits is zero.
+  int_vector m_low;
+
+  /// High bits of each position. The i-th set bit (0-based) with high part h
+  /// is represented by a one at position <tt>h + i</tt>.
+  bitmap m_high;
+};
+
+} // namespace brwt
+
+#endif // BRWT_SPARSE_BITMAP_H
@@ -2,12 +2,63 @@
 #define BRWT_WAVELET_TREE_WAVELET_TREE_H
 
 #include "brwt/bitmap.h"
+#include "brwt/bit_vector.h"
 #include "brwt/common_types.h"
+#include "brwt/fixed_int_vector.h"
+#include "brwt/image.h"
 #include "brwt/int_vector.h"
+#include <span>
 #include <utility>
 
 namespace brwt {
 
+namespace detail {
+
+/// \brief Sequence of symbols that a wavelet tree is built from, with its type
+/// erased so that the construction code is compiled once per symbol width.
+///
+class symbol_source {
+public:
+  template <typename Sequence>
+  explicit symbol_source(const Sequence& seq) noexcept
+      : m_seq{&seq},
+        m_decode{[](const void* s, const size_type first,
+                    const std::span<word_type> out) {
+          static_cast<const Sequence*>(s)->decode(first, out);
+        }},
+        m_size{seq.size()},
+        m_bits{static_cast<int>(seq.get_bpe())},
+        m_alloc{seq.get_allocator()} {}
+
+  size_type size() const noexcept {
+    return m_size;
+  }
+
+  int bits_per_symbol() const noexcept {
+    return m_bits;
+  }
+
+  bit_vector::allocator_type get_allocator() const noexcept {
+    return m_alloc;
+  }
+
+  /// \brief Copies the symbols <tt>[first, first + out.size())</tt> to \p
+  /// out.
+  ///
+  void decode(const size_type first, const std::span<word_type> out) const {
+    m_decode(m_seq, first, out);
+  }
+
+private:
+  const void* m_seq;
+  void (*m_decode)(const void*, size_type, std::span<word_type>);
+  size_type m_size;
+  int m_bits;
+  bit_vector::allocator_type m_alloc;
+};
+
+} // namespace detail
+
 /// \brief This class represents a wavelet tree.
 ///
 /// A wavelet tree is used to manipulate sequences. It provides access, rank and
@@ -29,7 +80,8 @@ public:
 
   /// \brief Constructs a wavelet tree from the given sequence.
   ///
-  /// \param sequence The input sequence.
+  /// \param sequence The input sequence. The tree allocates its storage with
+  /// the allocator of \p sequence.
   ///
   /// \post <tt>get_bits_per_symbol() == sequence.get_bpe()</tt>
   ///
@@ -44,6 +96,19 @@ public:
   ///
   explicit wavelet_tree(const int_vector& sequence);
 
+  /// \brief Constructs a wavelet tree from a sequence whose number of bits per
+  /// symbol is known at compile time.
+  ///
+  /// The result is the same as the one built from an \c int_vector with the
+  /// same contents.
+  ///
+  /// \par Complexity
+  /// The same as the constructor from \c int_vector.
+  ///
+  template <int Bits>
+  explicit wavelet_tree(const fixed_int_vector<Bits>& sequence)
+      : wavelet_tree(detail::symbol_source(sequence)) {}
+
   /// \brief Retrieves the symbol at the given position.
   ///
   /// \pre <tt>pos < size()</tt>
@@ -87,7 +152,24 @@ public:
   ///
   node_proxy make_root() const noexcept;
 
+  /// \brief Appends the wavelet tree to an image.
+  ///
+  /// \see image
+  ///
+  void save(image& img) const;
+
+  /// \brief Returns a wavelet tree that views the next wavelet tree saved in
+  /// the image of \p reader.
+  ///
+  /// \throws std::length_error if the image is truncated or corrupted.
+  ///
+  /// \see image
+  ///
+  static wavelet_tree view(image_reader& reader);
+
 private:
+  explicit wavelet_tree(const detail::symbol_source& source);
+
   /// Representation of the wavelet tree without pointers.
   bitmap table{};
 
@@ -123,6 +205,20 @@ public:
   ///
   size_type rank_1(index_type pos) const noexcept;
 
+  /// \brief Invokes the range \c rank_0 on this node bitmap.
+  ///
+  /// \pre <tt>first >= 0 && first <= last && last <= size()</tt>
+  ///
+  std::pair<size_type, size_type> rank_0(index_type first,
+                                         index_type last) const noexcept;
+
+  /// \brief Invokes the range \c rank_1 on this node bitmap.
+  ///
+  /// \pre <tt>first >= 0 && first <= last && last <= size()</tt>
+  ///
+  std::pair<size_type, size_type> rank_1(index_type first,
+                                         index_type last) const noexcept;
+
   /// \brief Invokes \c select_0 on this node bitmap.
   ///
   index_type select_0(size_type nth) const noexcept;
@@ -131,6 +227,18 @@ public:
   ///
   index_type select_1(size_type nth) const noexcept;
 
+  /// \brief Invokes \c select_next_0 on this node bitmap.
+  ///
+  /// \pre <tt>pos >= 0 && pos <= size()</tt>
+  ///
+  index_type select_next_0(index_type pos) const noexcept;
+
+  /// \brief Invokes \c select_next_1 on this node bitmap.
+  ///
+  /// \pre <tt>pos >= 0 && pos <= size()</tt>
+  ///
+  index_type select_next_1(index_type pos) const noexcept;
+
   /// \brief Retrieves the size of this node bitmap.
   ///
   size_type size() const noexcept {
@@ -1,17 +1,21 @@
 #include "brwt/binary_relation.h"
 #include "brwt/bit_ops.h"
 #include "brwt/bit_vector.h"
-#include "brwt/bitmap.h"
 #include "brwt/common_types.h"
+#include "brwt/image.h"
 #include "brwt/index_range.h"
 #include "brwt/int_vector.h"
+#include "brwt/sparse_bitmap.h"
 #include "brwt/wavelet_tree.h"
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <iterator>
 #include <numeric>
 #include <optional>
+#include <span>
+#include <stdexcept>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -179,11 +183,70 @@ void inplace_exclusive_scan(ForwardRange& range, const T init) {
                       init);
 }
 
+// Sorts `values` with an LSD radix sort on their lowest `bits` bits, using
+// `buffer` as scratch space. Each pass is a stable counting sort by one digit.
+void radix_sort(const std::span<word_type> values,
+                const std::span<word_type> buffer, const int bits) {
+  assert(buffer.size() >= values.size());
+  constexpr int digit_bits = 8;
+  constexpr size_t num_buckets = size_t{1} << digit_bits;
+
+  auto src = values;
+  auto dst = buffer.first(values.size());
+  for (int shift = 0; shift < bits; shift += digit_bits) {
+    std::array<size_t, num_buckets> bucket_pos{};
+    for (const auto value : src) {
+      ++bucket_pos[(value >> shift) % num_buckets];
+    }
+    inplace_exclusive_scan(bucket_pos, size_t{0});
+    for (const auto value : src) {
+      dst[bucket_pos[(value >> shift) % num_buckets]++] = value;
+    }
+    std::swap(src, dst);
+  }
+  if (src.data() != values.data()) {
+    std::ranges::copy(src, values.begin());
+  }
+}
+
+// Sorts the elements of `seq` in the range [first, last), removes their
+// duplicates and writes the result at `out`, which must not be greater than
+// `first`. Returns the number of written elements.
+//
+// The range is decoded into `scratch`, so the sort handles plain words instead
+// of going through the proxies of int_vector.
+size_type sort_unique(int_vector& seq, const size_type first,
+                      const size_type last, const size_type out,
+                      vector<word_type>& scratch) {
+  assert(out <= first && first <= last && last <= seq.size());
+  // Below this size, the histograms of the radix sort cost more than the
+  // comparisons of std::sort.
+  constexpr size_type radix_threshold = 256;
+
+  const auto count = static_cast<size_t>(last - first);
+  if (scratch.size() < 2 * count) {
+    scratch.resize(2 * count);
+  }
+  const auto values = std::span(scratch).first(count);
+  seq.decode(first, values);
+  if (last - first < radix_threshold) {
+    std::ranges::sort(values);
+  } else {
+    radix_sort(values, std::span(scratch).subspan(count, count),
+               static_cast<int>(seq.get_bpe()));
+  }
+  const auto unique = values.first(static_cast<size_t>(
+      std::ranges::unique(values).begin() - values.begin()));
+  seq.encode(out, unique);
+  return std::ssize(unique);
+}
+
 wavelet_tree make_wavelet_tree(const vector<pair_type>& pairs,
                                const label_id max_label,
-                               vector<size_type>& objects_frequency) {
+                               vector<size_type>& objects_frequency,
+                               const binary_relation::allocator_type& alloc) {
   int_vector seq(/*count=*/static_cast<size_type>(pairs.size()),
-                 /*bpe=*/used_bits(static_cast<word_type>(max_label)));
+                 /*bpe=*/used_bits(static_cast<word_type>(max_label)), alloc);
 
   // The first step is constructing the sequence of labels ordered by their
   // associated object value. The inplace_exclusive_scan and the for_each are an
@@ -200,19 +263,19 @@ wavelet_tree make_wavelet_tree(const vector<pair_type>& pairs,
   // Then, we have to sort each object range by label value and remove
   // duplicates. The one thing we know is the end of each object range (which is
   // stored in objects_frequency as a byproduct of the counting sort).
-  auto first = seq.begin();
-  auto seq_end = seq.begin();
+  vector<word_type> scratch;
+  size_type first = 0;
+  size_type seq_end = 0;
   std::ranges::for_each(objects_frequency, [&](size_type& freq) {
     // First, remove duplicates. Note that at this point, freq contains the
     // accumulated frequency of all pairs until the current object.
-    const auto last = seq.begin() + freq;
-    std::sort(first, last);
-    const auto unique_end = std::unique(first, last);
-    seq_end = std::copy(first, unique_end, seq_end);
+    const auto last = freq;
+    const auto num_unique = sort_unique(seq, first, last, seq_end, scratch);
+    seq_end += num_unique;
 
     // Then, use freq to keep the number of distinct pairs associated to the
     // current object (necessary for constructing the bitmap).
-    freq = std::distance(first, unique_end);
+    freq = num_unique;
 
     // Then, update first. Note that the end of the current object range is the
     // begin of the next object range.
@@ -221,30 +284,29 @@ wavelet_tree make_wavelet_tree(const vector<pair_type>& pairs,
 
   // Finally, erase unused elements (because removing of duplicates) and
   // construct the wavelet tree.
-  seq.erase(seq_end, seq.end());
+  seq.resize(seq_end);
   return wavelet_tree(seq);
 }
 
-bitmap make_bitmap(const vector<size_type>& objects_frequency,
-                   const size_type num_pairs) {
-  auto bit_seq = [&] {
-    const auto num_objects = static_cast<size_type>(objects_frequency.size());
-    return bit_vector(/*count=*/num_pairs + num_objects);
-  }();
+sparse_bitmap make_bitmap(const vector<size_type>& objects_frequency,
+                          const size_type num_pairs,
+                          const binary_relation::allocator_type& alloc) {
+  const auto num_objects = static_cast<size_type>(objects_frequency.size());
+  bit_vector_builder builder(alloc);
+  builder.reserve(num_pairs + num_objects);
 
-  size_type acc_count = 0;
   std::ranges::for_each(objects_frequency, [&](const size_type count) {
-    acc_count += count;
-    bit_seq.set(acc_count, true);
-    acc_count += 1;
+    builder.append(count, false);
+    builder.push_back(true);
   });
-  return bitmap(std::move(bit_seq));
+  return sparse_bitmap(std::move(builder).build());
 }
 
 } // namespace pairs_constructor_detail
 } // namespace
 
-binary_relation::binary_relation(const std::vector<pair_type>& pairs) {
+binary_relation::binary_relation(const std::vector<pair_type>& pairs,
+                                 const allocator_type& alloc) {
   if (pairs.empty()) {
     return;
   }
@@ -259,13 +321,14 @@ binary_relation::binary_relation(const std::vector<pair_type>& pairs) {
   namespace detail = pairs_constructor_detail;
   auto objects_frequency = detail::count_objects_frequency(pairs, max_object);
 
-  m_wtree = detail::make_wavelet_tree(pairs, max_label, objects_frequency);
+  m_wtree =
+      detail::make_wavelet_tree(pairs, max_label, objects_frequency, alloc);
 
   // Now that objects_frequency has been updated to contain the frequencies
   // of objects after ignoring duplicates pairs (done by make_wavelet_tree), we
   // can construct the bitmap.
   const auto num_unique_pairs = m_wtree.size();
-  m_bitmap = detail::make_bitmap(objects_frequency, num_unique_pairs);
+  m_bitmap = detail::make_bitmap(objects_frequency, num_unique_pairs, alloc);
 
   // TODO(Diego): Assert for m_wtree.sigma() when available.
   assert(m_wtree.size() == num_unique_pairs);
@@ -273,6 +336,21 @@ binary_relation::binary_relation(const std::vector<pair_type>& pairs) {
   assert(m_bitmap.num_ones() == to_integer(max_object) + 1);
 }
 
+void binary_relation::save(image& img) const {
+  m_wtree.save(img);
+  m_bitmap.save(img);
+}
+
+auto binary_relation::view(image_reader& reader) -> binary_relation {
+  binary_relation result;
+  result.m_wtree = wavelet_tree::view(reader);
+  result.m_bitmap = sparse_bitmap::view(reader);
+  if (result.m_bitmap.num_zeros() != result.m_wtree.size()) {
+    throw std::length_error("image: Corrupted binary relation");
+  }
+  return result;
+}
+
 auto binary_relation::rank(object_id max_object,
                            label_id max_label) const noexcept -> size_type {
   return exclusive_rank(m_wtree, less_equal<symbol_id>{as_symbol(max_label)},
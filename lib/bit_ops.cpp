@@ -0,0 +1,354 @@
+#include "brwt/bit_ops.h"
+#include "brwt/common_types.h"
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  define BRWT_HAS_BMI2_DISPATCH 1
+#  define BRWT_HAS_SIMD_DISPATCH 1
+#  include <immintrin.h>
+#endif
+
+namespace brwt::detail {
+
+namespace {
+
+using select_fn = int (*)(std::uint64_t, int) noexcept;
+
+int select_1_broadword(const std::uint64_t value, const int nth) noexcept {
+  return broadword_select_1(value, nth);
+}
+
+#ifdef BRWT_HAS_BMI2_DISPATCH
+
+[[gnu::target("bmi,bmi2")]] int select_1_bmi2(const std::uint64_t value,
+                                               const int nth) noexcept {
+  const auto mask = _pdep_u64(std::uint64_t{1} << (nth - 1), value);
+  return static_cast<int>(_tzcnt_u64(mask));
+}
+
+select_fn resolve_select_1() noexcept {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("bmi2")) {
+    return &select_1_bmi2;
+  }
+  return &select_1_broadword;
+}
+
+#else
+
+select_fn resolve_select_1() noexcept {
+  return &select_1_broadword;
+}
+
+#endif
+
+// Popcount kernels ----------------------
+
+using words_type = std::span<const word_type>;
+using counts_type = std::span<word_type>;
+
+using popcount_fn = std::int64_t (*)(words_type) noexcept;
+using prefix_popcount_fn = void (*)(words_type, counts_type) noexcept;
+
+struct popcount_impl {
+  popcount_fn popcount;
+  prefix_popcount_fn prefix_popcount;
+};
+
+std::int64_t popcount_scalar(const words_type words) noexcept {
+  std::int64_t count = 0;
+  for (const auto word : words) {
+    count += std::popcount(word);
+  }
+  return count;
+}
+
+void prefix_popcount_scalar(const words_type words,
+                            const counts_type out) noexcept {
+  word_type sum = 0;
+  for (std::size_t i = 0; i < words.size(); ++i) {
+    sum += static_cast<word_type>(std::popcount(words[i]));
+    out[i] = sum;
+  }
+}
+
+#ifdef BRWT_HAS_SIMD_DISPATCH
+
+// The scalar kernels again, with the POPCNT instruction enabled.
+
+// Four independent sums hide the latency of POPCNT, which some processors
+// serialize through a false dependency on its destination register.
+[[gnu::target("popcnt")]] std::int64_t
+popcount_popcnt(const words_type words) noexcept {
+  std::array<std::int64_t, 4> counts{};
+  std::size_t i = 0;
+  for (; i + 4 <= words.size(); i += 4) {
+    counts[0] += std::popcount(words[i + 0]);
+    counts[1] += std::popcount(words[i + 1]);
+    counts[2] += std::popcount(words[i + 2]);
+    counts[3] += std::popcount(words[i + 3]);
+  }
+  for (; i < words.size(); ++i) {
+    counts[0] += std::popcount(words[i]);
+  }
+  return (counts[0] + counts[1]) + (counts[2] + counts[3]);
+}
+
+[[gnu::target("popcnt")]] void
+prefix_popcount_popcnt(const words_type words, const counts_type out) noexcept {
+  word_type sum = 0;
+  for (std::size_t i = 0; i < words.size(); ++i) {
+    sum += static_cast<word_type>(std::popcount(words[i]));
+    out[i] = sum;
+  }
+}
+
+/// Words below which the AVX2 kernel is not faster than POPCNT.
+constexpr std::size_t min_avx2_words = 64;
+
+[[gnu::target("avx2")]] __m256i load_256(const word_type* ptr) noexcept {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+}
+
+/// Counts the set bits of each 64-bit lane, looking up the count of each
+/// nibble with PSHUFB and adding the bytes of each lane with PSADBW.
+[[gnu::target("avx2")]] __m256i popcount_256(const __m256i v) noexcept {
+  const auto lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3,
+                                       3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3,
+                                       2, 3, 3, 4);
+  const auto low_mask = _mm256_set1_epi8(0x0F);
+  const auto lo = _mm256_and_si256(v, low_mask);
+  const auto hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+  const auto counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                      _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+
+/// Carry-save adder: adds the bits of a, b and c, leaving the sum bits in
+/// `low` and the carry bits in `high`.
+[[gnu::target("avx2")]] void csa(__m256i& high, __m256i& low, const __m256i a,
+                                 const __m256i b, const __m256i c) noexcept {
+  const auto u = _mm256_xor_si256(a, b);
+  high = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+  low = _mm256_xor_si256(u, c);
+}
+
+[[gnu::target("avx2")]] std::int64_t sum_lanes(const __m256i v) noexcept {
+  return _mm256_extract_epi64(v, 0) + _mm256_extract_epi64(v, 1) +
+         _mm256_extract_epi64(v, 2) + _mm256_extract_epi64(v, 3);
+}
+
+/// Harley-Seal popcount: a tree of carry-save adders reduces 16 vectors to
+/// the bits of weight 16, so only one vector popcount is needed per 16
+/// vectors. See "Faster Population Counts Using AVX2 Instructions" by Mula,
+/// Kurz and Lemire.
+[[gnu::target("avx2,popcnt")]] std::int64_t
+popcount_avx2(const words_type words) noexcept {
+  if (words.size() < min_avx2_words) {
+    return popcount_popcnt(words);
+  }
+  const auto* ptr = words.data();
+  const auto* const vectors_end = ptr + words.size() / 4 * 4;
+
+  auto total = _mm256_setzero_si256();
+  auto ones = _mm256_setzero_si256();
+  auto twos = _mm256_setzero_si256();
+  auto fours = _mm256_setzero_si256();
+  auto eights = _mm256_setzero_si256();
+  __m256i twos_a, twos_b, fours_a, fours_b, eights_a, eights_b, sixteens;
+
+  for (; vectors_end - ptr >= 64; ptr += 64) {
+    csa(twos_a, ones, ones, load_256(ptr + 0), load_256(ptr + 4));
+    csa(twos_b, ones, ones, load_256(ptr + 8), load_256(ptr + 12));
+    csa(fours_a, twos, twos, twos_a, twos_b);
+    csa(twos_a, ones, ones, load_256(ptr + 16), load_256(ptr + 20));
+    csa(twos_b, ones, ones, load_256(ptr + 24), load_256(ptr + 28));
+    csa(fours_b, twos, twos, twos_a, twos_b);
+    csa(eights_a, fours, fours, fours_a, fours_b);
+    csa(twos_a, ones, ones, load_256(ptr + 32), load_256(ptr + 36));
+    csa(twos_b, ones, ones, load_256(ptr + 40), load_256(ptr + 44));
+    csa(fours_a, twos, twos, twos_a, twos_b);
+    csa(twos_a, ones, ones, load_256(ptr + 48), load_256(ptr + 52));
+    csa(twos_b, ones, ones, load_256(ptr + 56), load_256(ptr + 60));
+    csa(fours_b, twos, twos, twos_a, twos_b);
+    csa(eights_b, fours, fours, fours_a, fours_b);
+    csa(sixteens, eights, eights, eights_a, eights_b);
+    total = _mm256_add_epi64(total, popcount_256(sixteens));
+  }
+  total = _mm256_slli_epi64(total, 4);
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_256(eights), 3));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_256(fours), 2));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_256(twos), 1));
+  total = _mm256_add_epi64(total, popcount_256(ones));
+  for (; ptr != vectors_end; ptr += 4) {
+    total = _mm256_add_epi64(total, popcount_256(load_256(ptr)));
+  }
+  const auto tail = words.subspan(static_cast<std::size_t>(ptr - words.data()));
+  return sum_lanes(total) + popcount_popcnt(tail);
+}
+
+[[gnu::target("avx2,popcnt")]] void
+prefix_popcount_avx2(const words_type words, const counts_type out) noexcept {
+  const auto zero = _mm256_setzero_si256();
+  auto carry = zero;
+  std::size_t i = 0;
+  for (; i + 4 <= words.size(); i += 4) {
+    auto x = popcount_256(load_256(&words[i]));
+    // In-register prefix sum of the four lanes, in two shift-and-add steps.
+    x = _mm256_add_epi64(
+        x, _mm256_blend_epi32(
+               _mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero,
+               0x03));
+    x = _mm256_add_epi64(
+        x, _mm256_blend_epi32(
+               _mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)), zero,
+               0x0F));
+    x = _mm256_add_epi64(x, carry);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out[i]), x);
+    carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  auto sum = (i == 0) ? word_type{0} : out[i - 1];
+  for (; i < words.size(); ++i) {
+    sum += static_cast<word_type>(std::popcount(words[i]));
+    out[i] = sum;
+  }
+}
+
+/// Mask of the lanes that hold the first `count` words of a 512-bit vector.
+constexpr __mmask8 lanes_mask(const std::size_t count) noexcept {
+  return count >= 8 ? __mmask8{0xFF}
+                    : static_cast<__mmask8>((1U << count) - 1);
+}
+
+[[gnu::target("avx512f,avx512vpopcntdq")]] std::int64_t
+popcount_avx512(const words_type words) noexcept {
+  auto total = _mm512_setzero_si512();
+  for (std::size_t i = 0; i < words.size(); i += 8) {
+    const auto mask = lanes_mask(words.size() - i);
+    const auto v = _mm512_maskz_loadu_epi64(mask, &words[i]);
+    total = _mm512_add_epi64(total, _mm512_popcnt_epi64(v));
+  }
+  alignas(64) std::array<std::int64_t, 8> lanes;
+  _mm512_store_si512(lanes.data(), total);
+  return std::accumulate(lanes.begin(), lanes.end(), std::int64_t{0});
+}
+
+[[gnu::target("avx512f,avx512vpopcntdq")]] void
+prefix_popcount_avx512(const words_type words, const counts_type out) noexcept {
+  // Lane i of shift_by_k holds i - k.
+  const auto shift_by_1 = _mm512_set_epi64(6, 5, 4, 3, 2, 1, 0, 0);
+  const auto shift_by_2 = _mm512_set_epi64(5, 4, 3, 2, 1, 0, 0, 0);
+  const auto shift_by_4 = _mm512_set_epi64(3, 2, 1, 0, 0, 0, 0, 0);
+  const auto last_lane = _mm512_set1_epi64(7);
+
+  auto carry = _mm512_setzero_si512();
+  for (std::size_t i = 0; i < words.size(); i += 8) {
+    const auto mask = lanes_mask(words.size() - i);
+    auto x = _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(mask, &words[i]));
+    x = _mm512_add_epi64(
+        x, _mm512_maskz_permutexvar_epi64(0xFE, shift_by_1, x));
+    x = _mm512_add_epi64(
+        x, _mm512_maskz_permutexvar_epi64(0xFC, shift_by_2, x));
+    x = _mm512_add_epi64(
+        x, _mm512_maskz_permutexvar_epi64(0xF0, shift_by_4, x));
+    x = _mm512_add_epi64(x, carry);
+    _mm512_mask_storeu_epi64(&out[i], mask, x);
+    carry = _mm512_maskz_permutexvar_epi64(0xFF, last_lane, x);
+  }
+}
+
+#endif
+
+bool is_supported_impl(const popcount_kernel kernel) noexcept {
+#ifdef BRWT_HAS_SIMD_DISPATCH
+  __builtin_cpu_init();
+  switch (kernel) {
+  case popcount_kernel::scalar:
+    return true;
+  case popcount_kernel::avx2:
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+  case popcount_kernel::avx512:
+    return __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512vpopcntdq");
+  }
+  return false;
+#else
+  return kernel == popcount_kernel::scalar;
+#endif
+}
+
+popcount_impl get_impl(const popcount_kernel kernel) noexcept {
+  assert(is_supported_impl(kernel));
+#ifdef BRWT_HAS_SIMD_DISPATCH
+  switch (kernel) {
+  case popcount_kernel::scalar:
+    if (__builtin_cpu_supports("popcnt")) {
+      return {&popcount_popcnt, &prefix_popcount_popcnt};
+    }
+    break;
+  case popcount_kernel::avx2:
+    return {&popcount_avx2, &prefix_popcount_avx2};
+  case popcount_kernel::avx512:
+    return {&popcount_avx512, &prefix_popcount_avx512};
+  }
+#endif
+  return {&popcount_scalar, &prefix_popcount_scalar};
+}
+
+popcount_impl resolve_popcount() noexcept {
+  for (const auto kernel : {popcount_kernel::avx512, popcount_kernel::avx2}) {
+    if (is_supported_impl(kernel)) {
+      return get_impl(kernel);
+    }
+  }
+  return get_impl(popcount_kernel::scalar);
+}
+
+const popcount_impl& best_popcount_impl() noexcept {
+  static const popcount_impl impl = resolve_popcount();
+  return impl;
+}
+
+} // namespace
+
+int dispatched_select_1(const std::uint64_t value, const int nth) noexcept {
+  static const select_fn impl = resolve_select_1();
+  return impl(value, nth);
+}
+
+std::int64_t dispatched_popcount(const words_type words) noexcept {
+  return best_popcount_impl().popcount(words);
+}
+
+bool is_supported(const popcount_kernel kernel) noexcept {
+  return is_supported_impl(kernel);
+}
+
+std::int64_t popcount(const words_type words,
+                      const popcount_kernel kernel) noexcept {
+  return get_impl(kernel).popcount(words);
+}
+
+void prefix_popcount(const words_type words, const counts_type out,
+                     const popcount_kernel kernel) noexcept {
+  assert(out.size() == words.size());
+  get_impl(kernel).prefix_popcount(words, out);
+}
+
+} // namespace brwt::detail
+
+namespace brwt {
+
+void prefix_popcount(const std::span<const word_type> words,
+                     const std::span<word_type> out) noexcept {
+  assert(out.size() == words.size());
+  detail::best_popcount_impl().prefix_popcount(words, out);
+}
+
+} // namespace brwt
@@ -1,9 +1,21 @@
 #include "brwt/bit_vector.h"
 #include "brwt/bit_ops.h"
+#include "brwt/block_allocator.h"
+#include "brwt/common_types.h"
+#include "brwt/image.h"
 #include "brwt/utility.h"
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <utility>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
 
 namespace brwt {
 
@@ -25,18 +37,101 @@ constexpr block_type make_mask(const size_type count) noexcept {
              : lsb_mask<block_type>(static_cast<int>(count));
 }
 
+/// Reverses the order of the bits of a 64-bit block.
+constexpr block_type reverse_bits(block_type x) noexcept {
+  static_assert(bit_vector::bits_per_block == 64);
+  x = ((x >> 1) & 0x5555'5555'5555'5555) | ((x & 0x5555'5555'5555'5555) << 1);
+  x = ((x >> 2) & 0x3333'3333'3333'3333) | ((x & 0x3333'3333'3333'3333) << 2);
+  x = ((x >> 4) & 0x0F0F'0F0F'0F0F'0F0F) | ((x & 0x0F0F'0F0F'0F0F'0F0F) << 4);
+  x = ((x >> 8) & 0x00FF'00FF'00FF'00FF) | ((x & 0x00FF'00FF'00FF'00FF) << 8);
+  x = ((x >> 16) & 0x0000'FFFF'0000'FFFF) | ((x & 0x0000'FFFF'0000'FFFF) << 16);
+  return (x >> 32) | (x << 32);
+}
+
+/// Returns the block whose i-th bit is set if and only if <tt>chars[i] ==
+/// c</tt>, for each of the 64 characters starting at \p chars.
+block_type pack_equal(const char* const chars, const char c) noexcept {
+#if defined(__SSE2__)
+  const auto pattern = _mm_set1_epi8(c);
+  block_type block = 0;
+  for (int i = 0; i < 4; ++i) {
+    const auto v = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(chars + 16 * i)); // NOLINT
+    const auto mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, pattern));
+    block |= block_type{static_cast<std::uint16_t>(mask)} << (16 * i);
+  }
+  return block;
+#else
+  block_type block = 0;
+  for (int i = 0; i < 64; ++i) {
+    block |= block_type{chars[i] == c} << i;
+  }
+  return block;
+#endif
+}
+
+/// Returns the block whose i-th bit is <tt>bools[i]</tt>, for each of the 64
+/// bools starting at \p bools.
+block_type pack_bools(const bool* const bools) noexcept {
+#if defined(__SSE2__)
+  block_type block = 0;
+  for (int i = 0; i < 4; ++i) {
+    const auto v = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(bools + 16 * i)); // NOLINT
+    // A bool is stored as 0 or 1, so shifting moves it to the byte sign bit.
+    const auto mask = _mm_movemask_epi8(_mm_slli_epi64(v, 7));
+    block |= block_type{static_cast<std::uint16_t>(mask)} << (16 * i);
+  }
+  return block;
+#else
+  block_type block = 0;
+  for (int i = 0; i < 64; ++i) {
+    block |= block_type{bools[i]} << i;
+  }
+  return block;
+#endif
+}
+
+/// Loads \p count bytes as a little-endian block.
+block_type load_le(const std::uint8_t* const bytes,
+                   const std::size_t count) noexcept {
+  block_type block = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    block |= block_type{bytes[i]} << (8 * i);
+  }
+  return block;
+}
+
 } // namespace
 
-bit_vector::bit_vector(const size_type count) : m_len{count} {
+bit_vector::bit_vector(const size_type count, const allocator_type& alloc)
+    : m_len{count}, m_blocks(alloc) {
   assert(count >= 0);
 
-  const auto num_blocks = ceil_div(count, bits_per_block);
-  m_blocks.resize(num_blocks);
+  if (count > 0) {
+    // One more block for the padding.
+    m_blocks.resize(static_cast<std::size_t>(num_blocks() + 1));
+  }
+}
+
+bit_vector bit_vector::for_overwrite(const size_type count,
+                                     const allocator_type& alloc) {
+  assert(count >= 0);
+
+  bit_vector result;
+  result.m_len = count;
+  result.m_blocks = detail::array_storage<block_type>(alloc);
+  if (count > 0) {
+    const auto num_blocks = static_cast<std::size_t>(result.num_blocks());
+    result.m_blocks.resize_for_overwrite(num_blocks + 1);
+    result.m_blocks[num_blocks] = 0;
+  }
+  return result;
 }
 
 bit_vector::bit_vector(const size_type count, const block_type value)
     : bit_vector(count) {
-  if (m_blocks.empty()) {
+  if (num_blocks() == 0) {
     return;
   }
   const auto mask = make_mask(std::min(bits_per_block, count));
@@ -45,10 +140,87 @@ bit_vector::bit_vector(const size_type count, const block_type value)
 
 bit_vector::bit_vector(const std::string& s)
     : bit_vector(static_cast<size_type>(s.length())) {
-  auto rev_s = s.rbegin();
-  for (size_type i = 0; i < m_len; ++i) {
-    assert(rev_s[i] == '0' || rev_s[i] == '1');
-    set(i, rev_s[i] == '1');
+  // Block b holds the characters [m_len - 64 * (b + 1), m_len - 64 * b) in
+  // reverse order.
+  const auto full_blocks = m_len / bits_per_block;
+  for (size_type b = 0; b < full_blocks; ++b) {
+    const auto* chars = s.data() + (m_len - (b + 1) * bits_per_block);
+    assert(pack_equal(chars, '0') == ~pack_equal(chars, '1'));
+    m_blocks[static_cast<std::size_t>(b)] =
+        reverse_bits(pack_equal(chars, '1'));
+  }
+  for (auto i = full_blocks * bits_per_block; i < m_len; ++i) {
+    const auto c = s[static_cast<std::size_t>(m_len - 1 - i)];
+    assert(c == '0' || c == '1');
+    set(i, c == '1');
+  }
+}
+
+bit_vector::bit_vector(const std::span<const bool> bits,
+                       const allocator_type& alloc)
+    : bit_vector(static_cast<size_type>(bits.size()), alloc) {
+  const auto full_blocks = m_len / bits_per_block;
+  for (size_type b = 0; b < full_blocks; ++b) {
+    m_blocks[static_cast<std::size_t>(b)] =
+        pack_bools(bits.data() + b * bits_per_block);
+  }
+  for (auto i = full_blocks * bits_per_block; i < m_len; ++i) {
+    set(i, bits[static_cast<std::size_t>(i)]);
+  }
+}
+
+bit_vector::bit_vector(const std::span<const std::uint8_t> bytes,
+                       const size_type count, const allocator_type& alloc)
+    : bit_vector(count, alloc) {
+  assert(count <= static_cast<size_type>(bytes.size()) * 8);
+  constexpr auto bytes_per_block = sizeof(block_type);
+  const auto num_bytes =
+      static_cast<std::size_t>(ceil_div(count, size_type{8}));
+
+  // Copy whole blocks as little-endian words, then the remaining bytes.
+  const auto full_blocks = num_bytes / bytes_per_block;
+  for (std::size_t b = 0; b < full_blocks; ++b) {
+    m_blocks[b] = load_le(bytes.data() + b * bytes_per_block, bytes_per_block);
+  }
+  if (const auto rest = num_bytes % bytes_per_block; rest != 0) {
+    m_blocks[full_blocks] =
+        load_le(bytes.data() + full_blocks * bytes_per_block, rest);
+  }
+  clear_unused_bits();
+}
+
+bit_vector::bit_vector(const size_type count, storage_type blocks)
+    : m_len{count} {
+  assert(static_cast<size_type>(blocks.size()) == num_blocks());
+  if (count > 0) {
+    blocks.push_back(0);
+  }
+  m_blocks = std::move(blocks);
+  clear_unused_bits();
+}
+
+void bit_vector::save(image& img) const {
+  img.push_back(static_cast<word_type>(m_len));
+  detail::save_array<block_type>(img, m_blocks);
+}
+
+bit_vector bit_vector::view(image_reader& reader) {
+  bit_vector result;
+  result.m_len = static_cast<size_type>(reader.read_word());
+  result.m_blocks = detail::view_array<block_type>(reader);
+
+  const auto expected_blocks =
+      result.m_len == 0 ? 0 : result.num_blocks() + 1;
+  if (result.m_len < 0 || static_cast<size_type>(result.m_blocks.size()) !=
+                              expected_blocks) {
+    throw std::length_error("image: Corrupted bit vector");
+  }
+  return result;
+}
+
+void bit_vector::clear_unused_bits() noexcept {
+  if (const auto used = m_len % bits_per_block; used != 0) {
+    m_blocks[static_cast<std::size_t>(num_blocks() - 1)] &= make_mask(used);
   }
 }
 
@@ -56,6 +228,39 @@ size_type bit_vector::allocated_bytes() const noexcept {
   return static_cast<size_type>(m_blocks.capacity() * sizeof(block_type));
 }
 
+size_type bit_vector::capacity() const noexcept {
+  // One of the blocks is the padding.
+  const auto blocks = static_cast<size_type>(m_blocks.capacity());
+  return blocks == 0 ? 0 : (blocks - 1) * bits_per_block;
+}
+
+void bit_vector::resize(const size_type count) {
+  assert(count >= 0);
+  const auto old_len = m_len;
+  m_len = count;
+  if (count == 0) {
+    m_blocks.clear();
+    return;
+  }
+  // The unused bits and the padding block are zero, so growing only has to
+  // append zero blocks, which std::vector does geometrically.
+  m_blocks.resize(static_cast<std::size_t>(num_blocks() + 1));
+  if (count < old_len) {
+    m_blocks[static_cast<std::size_t>(num_blocks())] = 0;
+    clear_unused_bits();
+  }
+}
+
+void bit_vector::reserve(const size_type count) {
+  assert(count >= 0);
+  m_blocks.reserve(
+      static_cast<std::size_t>(ceil_div(count, bits_per_block) + 1));
+}
+
+void bit_vector::shrink_to_fit() {
+  m_blocks.shrink_to_fit();
+}
+
 bool bit_vector::get(const size_type pos) const noexcept {
   const auto block = at(m_blocks, pos / bits_per_block);
   const auto mask = (block_type{1} << (pos % bits_per_block));
@@ -73,57 +278,98 @@ void bit_vector::set(const size_type pos, const bool value) noexcept {
   }
 }
 
-block_type bit_vector::get_chunk(const size_type pos,
-                                 const size_type count) const noexcept {
-  assert(count >= 0 && count <= bits_per_block);
-  assert(pos >= 0 && pos + count <= length());
-
-  // l prefix refers to the left (or front) bit.
-  const auto lblock = pos / bits_per_block;
-  const auto loffset = pos % bits_per_block;
+void bit_vector::copy_bits(const bit_vector& src, const size_type src_pos,
+                           const size_type dst_pos,
+                           const size_type count) noexcept {
+  assert(count >= 0);
+  assert(src_pos >= 0 && src_pos + count <= src.size());
+  assert(dst_pos >= 0 && dst_pos + count <= size());
 
-  if (loffset + count <= bits_per_block) {
-    const auto mask = make_mask(count);
-    return (at(m_blocks, lblock) >> loffset) & mask;
-  }
+  // The bits before the first block boundary of the destination, then whole
+  // destination blocks, then the remaining bits.
+  const auto head =
+      std::min(count, (bits_per_block - dst_pos % bits_per_block) %
+                          bits_per_block);
+  const auto num_full = (count - head) / bits_per_block;
+  const auto tail_offset = head + num_full * bits_per_block;
+  const auto first_block = (dst_pos + head) / bits_per_block;
 
-  const auto lcount = bits_per_block - loffset;
-  assert(lcount < count);
-  const auto rcount = count - lcount;
+  const auto copy_head = [&] {
+    set_chunk(dst_pos, head, src.get_chunk(src_pos, head));
+  };
+  const auto copy_block = [&](const size_type i) {
+    const auto pos = src_pos + head + i * bits_per_block;
+    m_blocks[static_cast<std::size_t>(first_block + i)] =
+        src.get_chunk(pos, bits_per_block);
+  };
+  const auto copy_tail = [&] {
+    set_chunk(dst_pos + tail_offset, count - tail_offset,
+              src.get_chunk(src_pos + tail_offset, count - tail_offset));
+  };
 
-  const auto rmask = make_mask(rcount);
-  auto result = at(m_blocks, lblock) >> loffset;
-  result |= (at(m_blocks, lblock + 1) & rmask) << lcount;
-  return result;
+  // As in memmove, copy backwards when the destination follows an
+  // overlapping source, so that no source bit is overwritten before it is
+  // read.
+  if (&src != this || dst_pos <= src_pos) {
+    copy_head();
+    for (size_type i = 0; i < num_full; ++i) {
+      copy_block(i);
+    }
+    copy_tail();
+  } else {
+    copy_tail();
+    for (auto i = num_full; i > 0; --i) {
+      copy_block(i - 1);
+    }
+    copy_head();
+  }
 }
 
-void bit_vector::set_chunk(const size_type pos, const size_type count,
-                           const block_type value) noexcept {
-  assert(count >= 0 && count <= bits_per_block);
-  assert(pos >= 0 && pos + count <= length());
+// ==========================================
+// bit_vector_builder
+// ==========================================
 
-  const auto lblock = pos / bits_per_block;
-  const auto loffset = pos % bits_per_block;
+bit_vector_builder::bit_vector_builder(
+    const bit_vector::allocator_type& alloc)
+    : m_blocks(alloc) {}
 
-  if (loffset + count <= bits_per_block) {
-    const auto mask = make_mask(count);
-    at(m_blocks, lblock) &= ~(mask << loffset);
-    at(m_blocks, lblock) |= (value & mask) << loffset;
-    return;
-  }
+void bit_vector_builder::reserve(const size_type count) {
+  assert(count >= 0);
+  // One more block for the padding of the result.
+  m_blocks.reserve(
+      static_cast<std::size_t>(ceil_div(count, bits_per_block) + 1));
+}
 
-  const auto lcount = bits_per_block - loffset;
-  assert(lcount < count);
-  const auto rcount = count - lcount;
+void bit_vector_builder::append(size_type count, const bool value) {
+  assert(count >= 0);
+  const auto fill = value ? ~block_type{0} : block_type{0};
 
-  const auto lmask = make_mask(lcount);
-  const auto rmask = make_mask(rcount);
+  // Complete the buffered block, then append whole blocks directly.
+  const auto used = m_len % bits_per_block;
+  const auto head = std::min(count, used == 0 ? 0 : bits_per_block - used);
+  append_bits(fill, head);
+  count -= head;
 
-  at(m_blocks, lblock) &= ~(lmask << loffset);
-  at(m_blocks, lblock) |= (value & lmask) << loffset;
+  const auto num_blocks = count / bits_per_block;
+  m_blocks.insert(m_blocks.end(), static_cast<std::size_t>(num_blocks), fill);
+  m_len += num_blocks * bits_per_block;
+  append_bits(fill, count % bits_per_block);
+}
+
+bit_vector bit_vector_builder::build() && {
+  if (m_len % bits_per_block != 0) {
+    flush_block();
+  }
+  bit_vector result(m_len, std::move(m_blocks));
+  m_len = 0;
+  m_buffer = 0;
+  m_blocks.clear();
+  return result;
+}
 
-  at(m_blocks, lblock + 1) &= ~rmask;
-  at(m_blocks, lblock + 1) |= (value >> lcount) & rmask;
+void bit_vector_builder::flush_block() {
+  m_blocks.push_back(m_buffer);
+  m_buffer = 0;
 }
 
 } // namespace brwt
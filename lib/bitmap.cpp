@@ -2,22 +2,27 @@
 #include "brwt/bit_ops.h"
 #include "brwt/bit_vector.h"
 #include "brwt/common_types.h"
-#include "brwt/int_vector.h"
+#include "brwt/image.h"
+#include "brwt/rank_layout.h"
 #include "brwt/utility.h"
 #include <algorithm>
+#include <array>
 #include <bit>
 #include <cassert>
+#include <cstddef>
 #include <iterator>
 #include <limits>
+#include <numeric>
 #include <span>
+#include <stdexcept>
+#include <thread>
 #include <utility>
+#include <vector>
 
 namespace brwt {
 
 namespace {
 
-using block_t = bit_vector::block_type;
-
 // TODO(Diego): Use int_binary_search.
 //
 template <typename T, typename Pred>
@@ -34,55 +39,114 @@ constexpr T binary_search(T a, T b, Pred pred) {
   return a;
 }
 
-template <large_unsigned_integer T>
-constexpr int size_in_bits = std::numeric_limits<T>::digits;
-
 template <bool B, large_unsigned_integer T>
-constexpr int count(const T value) {
+constexpr int select(const T value, const int nth) {
   if constexpr (B) {
-    return std::popcount(value);
+    return select_1(value, nth);
   } else {
-    return std::popcount(~value);
+    return select_0(value, nth);
   }
 }
 
-template <large_unsigned_integer T>
-constexpr int select_1(const T value, const int nth) {
-  assert(nth > 0 && nth <= std::popcount(value));
-  auto not_enough = [value, nth](const int pos) {
-    return rank_1(value, pos) < nth;
-  };
-  return binary_search(nth - 1, size_in_bits<T> - 1, not_enough);
+/// Returns a word whose set bits are the bits of `value` equal to B.
+template <bool B>
+constexpr word_type matching_bits(const word_type value) noexcept {
+  return B ? value : ~value;
 }
 
-template <large_unsigned_integer T>
-constexpr int select_0(const T value, const int nth) {
-  return select_1(~value, nth);
+/// Hints the processor to bring the cache line of `ptr` into the cache.
+inline void prefetch(const void* const ptr) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(ptr);
+#else
+  static_cast<void>(ptr);
+#endif
 }
 
-template <bool B, large_unsigned_integer T>
-constexpr int select(const T value, const int nth) {
-  if constexpr (B) {
-    return select_1(value, nth);
-  } else {
-    return select_0(value, nth);
+/// Number of queries in flight in the batched queries. It must be large enough
+/// to keep several cache misses outstanding, and small enough for the
+/// prefetched lines to remain in L1 until they are used.
+constexpr std::size_t batch_size = 16;
+
+/// Super blocks below which a thread is not worth starting during
+/// construction (about 8 Mbit of data per thread).
+constexpr size_type min_super_blocks_per_thread = size_type{1} << 14;
+
+/// Maps the num_threads construction option to an actual number of threads.
+size_type resolve_num_threads(const int num_threads) noexcept {
+  if (num_threads != 0) {
+    return num_threads;
+  }
+  return std::max(1U, std::thread::hardware_concurrency());
+}
+
+/// Invokes f(i) for every i in [0, count), each call in its own thread. The
+/// last call runs in the calling thread.
+template <typename Function>
+void parallel_for(const size_type count, Function f) {
+  assert(count > 0);
+
+  std::vector<std::jthread> threads;
+  threads.reserve(static_cast<std::size_t>(count - 1));
+  for (size_type i = 0; i + 1 < count; ++i) {
+    threads.emplace_back(f, i);
   }
+  f(count - 1);
 }
 
 constexpr size_type bits_per_block = bit_vector::bits_per_block;
-constexpr size_type blocks_per_super_block = 8;
-constexpr size_type bits_per_super_block =
-    blocks_per_super_block * bits_per_block;
 
 static_assert(is_power_of_two(bits_per_block));
-static_assert(is_power_of_two(blocks_per_super_block));
-static_assert(is_power_of_two(bits_per_super_block));
+
+/// Maximum number of blocks per super block of the layouts with block
+/// counters.
+constexpr size_type max_blocks_with_counters = 8;
+
+/// Number of blocks whose prefix popcounts are computed at once during
+/// construction. A multiple of every super block span.
+constexpr size_type blocks_per_tile = 1024;
+
+/// Counts the bits equal to B in a block.
+template <bool B>
+constexpr size_type count(const word_type block) noexcept {
+  const auto ones = std::popcount(block);
+  return B ? ones : bits_per_block - ones;
+}
+
+/// Number of bits used by each relative rank in a rank entry. It must be able
+/// to represent the number of bits of a super block (minus the last block).
+constexpr int bits_per_rel_rank = 9;
+constexpr word_type rel_rank_mask = lsb_mask<word_type>(bits_per_rel_rank);
+
+static_assert(used_bits(static_cast<word_type>(
+                  (max_blocks_with_counters - 1) * bits_per_block)) <=
+              bits_per_rel_rank);
+static_assert((max_blocks_with_counters - 1) * bits_per_rel_rank <
+              std::numeric_limits<word_type>::digits);
+
+/// Extracts the number of set bits that precede the `block_idx`-th block of a
+/// super block.
+///
+/// The first block has no stored counter. Instead of branching on it, the
+/// shift is computed so that it reads the most significant bit of
+/// `rel_ranks`, which is never set.
+///
+constexpr size_type relative_rank(const word_type rel_ranks,
+                                  const size_type block_idx) noexcept {
+  assert(block_idx >= 0 && block_idx < max_blocks_with_counters);
+
+  const auto t = static_cast<word_type>(block_idx) - 1;
+  const auto shift = (t + ((t >> 60) & 8)) * bits_per_rel_rank;
+  return static_cast<size_type>((rel_ranks >> shift) & rel_rank_mask);
+}
 
 } // namespace
 
 /// Returns the range of blocks belonging to the super block `sb_idx`.
 ///
-auto bitmap::blocks_of_super_block(const size_type sb_idx) const noexcept {
+template <typename Layout>
+auto basic_bitmap<Layout>::blocks_of_super_block(
+    const size_type sb_idx) const noexcept {
   const auto blocks = bit_seq.get_blocks();
   const auto offset = sb_idx * blocks_per_super_block;
   const auto count =
@@ -90,72 +154,301 @@ auto bitmap::blocks_of_super_block(const size_type sb_idx) const noexcept {
   return blocks.subspan(offset, count);
 }
 
-auto bitmap::num_super_blocks() const noexcept -> size_type {
-  return sb_rank_1.size();
+template <typename Layout>
+auto basic_bitmap<Layout>::num_super_blocks() const noexcept -> size_type {
+  return rank_dir.size() == 0 ? 0 : rank_dir.size() - 1;
 }
 
-namespace {
+template <typename Layout>
+basic_bitmap<Layout>::basic_bitmap(bit_vector vec,
+                                   const bitmap_options options)
+    : bit_seq(std::move(vec)) {
+  build_directories(options, [](index_type, index_type) {});
+}
+
+/// Builds the rank and select directories of `bit_seq`. Before the blocks in
+/// [first, last) are counted, `fill_tile(first, last)` is invoked so that the
+/// caller can produce them while the previous ones are still in cache.
+template <typename Layout>
+template <typename Function>
+void basic_bitmap<Layout>::build_directories(const bitmap_options options,
+                                             Function fill_tile) {
+  assert(options.select_sample_rate >= 0);
+  assert(options.num_threads >= 0);
+
+  const auto count = ceil_div(bit_seq.num_blocks(), blocks_per_super_block);
+  // The directories use the allocator of the sequence.
+  rank_dir = detail::rank_directory<Layout>(count + 1, size(),
+                                            bit_seq.get_allocator());
+
+  const auto num_chunks = std::min<size_type>(
+      resolve_num_threads(options.num_threads),
+      std::max<size_type>(1, count / min_super_blocks_per_thread));
+
+  if (num_chunks == 1) {
+    rank_dir.set_abs_rank(count, build_rank_entries(0, count, fill_tile));
+  } else {
+    // Each thread fills the entries of a contiguous range of super blocks as
+    // if the range started the sequence. Then, the absolute ranks are shifted
+    // by the number of set bits of the preceding ranges, so the directory is
+    // identical to the one built sequentially. The chunks are aligned so that
+    // no word of the directory is written by two threads.
+    constexpr auto alignment =
+        detail::rank_directory<Layout>::concurrent_alignment;
+    auto chunk_first = [&](const size_type chunk) {
+      if (chunk == num_chunks) {
+        return count;
+      }
+      return (chunk * count / num_chunks) / alignment * alignment;
+    };
+    std::vector<word_type> chunk_ones(static_cast<std::size_t>(num_chunks));
+    parallel_for(num_chunks, [&](const size_type chunk) {
+      chunk_ones[chunk] = build_rank_entries(
+          chunk_first(chunk), chunk_first(chunk + 1), fill_tile);
+    });
+
+    const auto total = std::reduce(chunk_ones.begin(), chunk_ones.end());
+    std::exclusive_scan(chunk_ones.begin(), chunk_ones.end(),
+                        chunk_ones.begin(), word_type{0});
+    parallel_for(num_chunks, [&](const size_type chunk) {
+      rank_dir.add_to_abs_ranks(chunk_first(chunk), chunk_first(chunk + 1),
+                                chunk_ones[chunk]);
+    });
+    rank_dir.set_abs_rank(count, total);
+  }
+
+  if (options.select_sample_rate > 0) {
+    build_select_samples<1>(options.select_sample_rate);
+    build_select_samples<0>(options.select_sample_rate);
+    select_sample_rate = options.select_sample_rate;
+  }
+}
 
-/// Sequentially counts the number of set bits in the given range of blocks.
+/// Fills the rank entries of the super blocks in [sb_first, sb_last), with
+/// absolute ranks counted from `sb_first`. Returns the number of set bits in
+/// the range.
 ///
-constexpr size_type pop_count(const std::span<const block_t> blocks) {
-  size_type sum = 0;
-  for (const auto elem : blocks) {
-    sum += std::popcount(elem);
+/// The blocks are processed in tiles whose prefix popcounts are computed at
+/// once, so the counting is vectorized. Each tile is first produced with
+/// `fill_tile` (see build_directories).
+template <typename Layout>
+template <typename Function>
+auto basic_bitmap<Layout>::build_rank_entries(const index_type sb_first,
+                                              const index_type sb_last,
+                                              Function fill_tile) noexcept
+    -> word_type {
+  constexpr auto super_blocks_per_tile =
+      blocks_per_tile / blocks_per_super_block;
+
+  const auto blocks = bit_seq.get_blocks();
+  std::array<word_type, blocks_per_tile> prefix;
+
+  word_type acc_sum = 0;
+  for (auto tile_first = sb_first; tile_first < sb_last;
+       tile_first += super_blocks_per_tile) {
+    const auto tile_last =
+        std::min(tile_first + super_blocks_per_tile, sb_last);
+    const auto block_first = tile_first * blocks_per_super_block;
+    const auto block_last =
+        std::min(tile_last * blocks_per_super_block, std::ssize(blocks));
+    fill_tile(block_first, block_last);
+
+    const auto counts = std::span(prefix).first(
+        static_cast<std::size_t>(block_last - block_first));
+    prefix_popcount(blocks.subspan(static_cast<std::size_t>(block_first),
+                                   counts.size()),
+                    counts);
+
+    // Number of set bits of the tile before its `offset`-th block.
+    auto ones_before = [&](const size_type offset) -> word_type {
+      return offset == 0 ? 0 : counts[static_cast<std::size_t>(offset - 1)];
+    };
+
+    for (auto i = tile_first; i < tile_last; ++i) {
+      const auto offset = (i - tile_first) * blocks_per_super_block;
+      const auto sb_ones = ones_before(offset);
+      rank_dir.set_abs_rank(i, acc_sum + sb_ones);
+
+      if constexpr (Layout::block_counters) {
+        // The counters of the missing blocks of the last super block are
+        // never read.
+        const auto num_blocks =
+            std::min(blocks_per_super_block, std::ssize(counts) - offset);
+        word_type rel_ranks = 0;
+        for (size_type j = 1; j < num_blocks; ++j) {
+          const auto rel_sum = ones_before(offset + j) - sb_ones;
+          rel_ranks |= rel_sum << ((j - 1) * bits_per_rel_rank);
+        }
+        rank_dir.set_rel_ranks(i, rel_ranks);
+      }
+    }
+    acc_sum += counts.back();
   }
-  return sum;
+  return acc_sum;
 }
 
-} // namespace
+// Bitwise operations ----------------------
+
+template <typename Layout>
+template <typename Operation>
+auto basic_bitmap<Layout>::combine(const basic_bitmap& other, Operation op,
+                                   const bitmap_options options) const
+    -> basic_bitmap {
+  assert(size() == other.size());
+
+  const auto lhs = bit_seq.get_blocks();
+  const auto rhs = other.bit_seq.get_blocks();
+
+  basic_bitmap result;
+  // The blocks of the result are written once, by the tiles.
+  result.bit_seq = bit_vector::for_overwrite(size(), bit_seq.get_allocator());
+  const auto out = result.bit_seq.get_mutable_blocks();
+  // The unused bits of the last blocks are zero in both operands, and so they
+  // are in the result of every operation.
+  result.build_directories(options, [&](const index_type first,
+                                        const index_type last) {
+    const auto* const a = lhs.data();
+    const auto* const b = rhs.data();
+    auto* const dst = out.data();
+    for (auto i = first; i < last; ++i) {
+      dst[i] = op(a[i], b[i]);
+    }
+  });
+  return result;
+}
 
-bitmap::bitmap(bit_vector vec) : bit_seq(std::move(vec)) {
+template <typename Layout>
+auto basic_bitmap<Layout>::bit_and(const basic_bitmap& other,
+                                   const bitmap_options options) const
+    -> basic_bitmap {
+  return combine(
+      other, [](const word_type a, const word_type b) { return a & b; },
+      options);
+}
 
-  sb_rank_1 = [this] {
-    const auto count = ceil_div(bit_seq.num_blocks(), blocks_per_super_block);
-    const int bpe = used_bits(static_cast<word_type>(bit_seq.size()));
-    return int_vector(count, bpe);
-  }();
+template <typename Layout>
+auto basic_bitmap<Layout>::bit_or(const basic_bitmap& other,
+                                  const bitmap_options options) const
+    -> basic_bitmap {
+  return combine(
+      other, [](const word_type a, const word_type b) { return a | b; },
+      options);
+}
 
-  size_type acc_sum = 0;
-  for (size_type i = 0; i < num_super_blocks(); ++i) {
-    // TODO(Diego): Try to use transform_inclusive_scan when available.
-    acc_sum += brwt::pop_count(blocks_of_super_block(i));
-    sb_rank_1[i] = static_cast<word_type>(acc_sum);
+template <typename Layout>
+auto basic_bitmap<Layout>::bit_xor(const basic_bitmap& other,
+                                   const bitmap_options options) const
+    -> basic_bitmap {
+  return combine(
+      other, [](const word_type a, const word_type b) { return a ^ b; },
+      options);
+}
+
+template <typename Layout>
+auto basic_bitmap<Layout>::bit_andnot(const basic_bitmap& other,
+                                      const bitmap_options options) const
+    -> basic_bitmap {
+  return combine(
+      other, [](const word_type a, const word_type b) { return a & ~b; },
+      options);
+}
+
+template <typename Layout>
+auto basic_bitmap<Layout>::allocated_bytes() const noexcept -> size_type {
+  auto bytes = bit_seq.allocated_bytes() + rank_dir.allocated_bytes();
+  for (const auto& samples : select_samples) {
+    bytes += static_cast<size_type>(samples.capacity() * sizeof(index_type));
   }
+  return bytes;
 }
 
+template <typename Layout>
+void basic_bitmap<Layout>::save(image& img) const {
+  bit_seq.save(img);
+  rank_dir.save(img);
+  img.push_back(static_cast<word_type>(select_sample_rate));
+  for (const auto& samples : select_samples) {
+    detail::save_array<index_type>(img, samples);
+  }
+}
+
+template <typename Layout>
+auto basic_bitmap<Layout>::view(image_reader& reader) -> basic_bitmap {
+  basic_bitmap result;
+  result.bit_seq = bit_vector::view(reader);
+  result.rank_dir = detail::rank_directory<Layout>::view(reader);
+  result.select_sample_rate = static_cast<size_type>(reader.read_word());
+  for (auto& samples : result.select_samples) {
+    samples = detail::view_array<index_type>(reader);
+  }
+
+  // Queries trust the directories, so check at least that their sizes match
+  // the sequence.
+  const auto count =
+      ceil_div(result.bit_seq.num_blocks(), blocks_per_super_block);
+  const bool is_default = result.size() == 0 && result.rank_dir.size() == 0;
+  if (!is_default && result.rank_dir.size() != count + 1) {
+    throw std::length_error("image: Corrupted bitmap");
+  }
+  const auto rate = result.select_sample_rate;
+  const auto expected_samples = [&](const size_type num) {
+    return rate > 0 ? ceil_div(num, rate) : 0;
+  };
+  if (rate < 0 ||
+      std::ssize(result.select_samples[0]) !=
+          expected_samples(result.num_zeros()) ||
+      std::ssize(result.select_samples[1]) !=
+          expected_samples(result.num_ones())) {
+    throw std::length_error("image: Corrupted bitmap");
+  }
+  return result;
+}
+
+template <typename Layout>
 template <bool B>
-auto bitmap::num_of() const noexcept -> size_type {
+auto basic_bitmap<Layout>::num_of() const noexcept -> size_type {
   return B ? num_ones() : num_zeros();
 }
 
 // Rank lands ----------------------
 
-template <>
-auto bitmap::sb_rank<true>(const index_type sb_idx) const noexcept
-    -> size_type {
-  assert(sb_idx < num_super_blocks());
+template <typename Layout>
+template <bool B>
+auto basic_bitmap<Layout>::sb_exclusive_rank(
+    const index_type sb_idx) const noexcept -> size_type {
+  assert(sb_idx >= 0 && sb_idx <= num_super_blocks());
 
-  return static_cast<size_type>(sb_rank_1[sb_idx]);
+  const auto ones = static_cast<size_type>(rank_dir.abs_rank(sb_idx));
+  if constexpr (B) {
+    return ones;
+  } else {
+    return std::min(sb_idx * bits_per_super_block, size()) - ones;
+  }
 }
 
-template <>
-auto bitmap::sb_rank<false>(const index_type sb_idx) const noexcept
+/// Counts the bits equal to B that precede the block `block_idx` (relative to
+/// the super block `sb_idx`) within its super block.
+template <typename Layout>
+template <bool B>
+auto basic_bitmap<Layout>::block_exclusive_rank(
+    const index_type sb_idx, const index_type block_idx) const noexcept
     -> size_type {
-  assert(sb_idx < num_super_blocks());
+  assert(sb_idx >= 0 && sb_idx < num_super_blocks());
+  assert(block_idx >= 0 && block_idx < blocks_per_super_block);
 
-  const auto total = std::min((sb_idx + 1) * bits_per_super_block, size());
-  return total - sb_rank<true>(sb_idx);
+  size_type ones = 0;
+  if constexpr (Layout::block_counters) {
+    ones = relative_rank(rank_dir.rel_ranks(sb_idx), block_idx);
+  } else {
+    const auto blocks = blocks_of_super_block(sb_idx);
+    ones = popcount(blocks.first(static_cast<std::size_t>(block_idx)));
+  }
+  return B ? ones : block_idx * bits_per_block - ones;
 }
 
-template <bool B>
-auto bitmap::sb_exclusive_rank(const size_type sb_idx) const noexcept
+template <typename Layout>
+auto basic_bitmap<Layout>::rank_1(const index_type pos) const noexcept
     -> size_type {
-  assert(sb_idx <= num_super_blocks());
-  return sb_idx == 0 ? 0 : sb_rank<B>(sb_idx - 1);
-}
-
-auto bitmap::rank_1(const index_type pos) const noexcept -> size_type {
   assert(pos >= 0 && pos < length());
 
   // Address
@@ -163,73 +456,193 @@ auto bitmap::rank_1(const index_type pos) const noexcept -> size_type {
   const auto block_idx = pos / bits_per_block;
   const auto bit_idx = static_cast<int>(pos % bits_per_block);
 
-  size_type sum = sb_exclusive_rank<1>(sb_idx);
+  return sb_exclusive_rank<1>(sb_idx) +
+         block_exclusive_rank<1>(sb_idx, block_idx % blocks_per_super_block) +
+         brwt::rank_1(bit_seq.get_block(block_idx), bit_idx);
+}
+
+template <typename Layout>
+auto basic_bitmap<Layout>::rank_0(const index_type pos) const noexcept
+    -> size_type {
+  return (pos + 1) - rank_1(pos);
+}
 
-  for (index_type ith = (sb_idx * blocks_per_super_block); ith < block_idx;
-       ++ith) {
-    sum += std::popcount(bit_seq.get_block(ith));
+/// Counts the set bits of the block containing `pos` that precede `pos`.
+template <typename Layout>
+auto basic_bitmap<Layout>::ones_in_block_before(
+    const index_type pos) const noexcept -> size_type {
+  const auto bit_idx = static_cast<int>(pos % bits_per_block);
+  if (bit_idx == 0) {
+    // The block may be past the end of the sequence.
+    return 0;
   }
+  return brwt::rank_1(bit_seq.get_block(pos / bits_per_block), bit_idx - 1);
+}
 
-  sum += brwt::rank_1(bit_seq.get_block(block_idx), bit_idx);
+/// Counts the set bits in positions less than `pos`.
+template <typename Layout>
+auto basic_bitmap<Layout>::ones_before(const index_type pos) const noexcept
+    -> size_type {
+  assert(pos >= 0 && pos <= size());
+  if (pos == size()) {
+    // The blocks that follow the last bit have no counters.
+    return num_ones();
+  }
 
-  return sum;
+  const auto sb_idx = pos / bits_per_super_block;
+  const auto ones = sb_exclusive_rank<1>(sb_idx);
+  if (pos % bits_per_super_block == 0) {
+    return ones;
+  }
+  const auto block_idx = (pos / bits_per_block) % blocks_per_super_block;
+  return ones + block_exclusive_rank<1>(sb_idx, block_idx) +
+         ones_in_block_before(pos);
 }
 
-auto bitmap::rank_0(const index_type pos) const noexcept -> size_type {
-  return (pos + 1) - rank_1(pos);
+template <typename Layout>
+auto basic_bitmap<Layout>::rank_1(const index_type first,
+                                  const index_type last) const noexcept
+    -> std::pair<size_type, size_type> {
+  assert(first >= 0 && first <= last && last <= size());
+
+  const auto sb_idx = first / bits_per_super_block;
+  if (last / bits_per_super_block != sb_idx ||
+      last % bits_per_super_block == 0 || last == size()) {
+    return {ones_before(first), ones_before(last)};
+  }
+
+  // Both ends are in the super block sb_idx, so its entry is shared.
+  const auto sb_first_block = sb_idx * blocks_per_super_block;
+  const auto first_block = first / bits_per_block;
+  const auto last_block = last / bits_per_block;
+
+  auto first_ones = sb_exclusive_rank<1>(sb_idx);
+  auto last_ones = first_ones;
+  if constexpr (Layout::block_counters) {
+    const auto rel_ranks = rank_dir.rel_ranks(sb_idx);
+    first_ones += relative_rank(rel_ranks, first_block - sb_first_block);
+    last_ones += relative_rank(rel_ranks, last_block - sb_first_block);
+  } else {
+    first_ones += block_exclusive_rank<1>(sb_idx, first_block - sb_first_block);
+    const auto between = bit_seq.get_blocks().subspan(
+        static_cast<std::size_t>(first_block),
+        static_cast<std::size_t>(last_block - first_block));
+    last_ones = first_ones + popcount(between);
+  }
+  return {first_ones + ones_in_block_before(first),
+          last_ones + ones_in_block_before(last)};
+}
+
+template <typename Layout>
+auto basic_bitmap<Layout>::rank_0(const index_type first,
+                                  const index_type last) const noexcept
+    -> std::pair<size_type, size_type> {
+  const auto [first_ones, last_ones] = rank_1(first, last);
+  return {first - first_ones, last - last_ones};
 }
 
 // Select lands ----------------------
 
-/// Finds the super block that contains the nth bit equal to B.
+/// Samples the super block of every `sample_rate`-th bit equal to B.
+template <typename Layout>
+template <bool B>
+void basic_bitmap<Layout>::build_select_samples(const size_type sample_rate) {
+  assert(sample_rate > 0);
+
+  auto& samples = select_samples[B];
+  samples = sample_array(bit_seq.get_allocator());
+  samples.reserve(static_cast<std::size_t>(ceil_div(num_of<B>(), sample_rate)));
+
+  size_type next_nth = 1;
+  for (index_type sb_idx = 0; sb_idx < num_super_blocks(); ++sb_idx) {
+    const auto count = sb_exclusive_rank<B>(sb_idx + 1);
+    for (; next_nth <= count; next_nth += sample_rate) {
+      samples.push_back(sb_idx);
+    }
+  }
+}
+
+/// Returns the range [first, last] of super blocks where the nth bit equal to
+/// B must be searched.
+template <typename Layout>
 template <bool B>
-auto bitmap::sb_select(const size_type nth) const noexcept -> size_type {
+auto basic_bitmap<Layout>::sb_select_range(const size_type nth) const noexcept
+    -> std::pair<index_type, index_type> {
   assert(nth > 0);
   assert(nth <= num_of<B>());
   assert(num_super_blocks() > 0);
 
-  auto not_enough = [&](const index_type pos) { return sb_rank<B>(pos) < nth; };
-  const auto sb_begin = (nth - 1) / bits_per_super_block;
+  auto sb_first = (nth - 1) / bits_per_super_block;
+  auto sb_last = num_super_blocks() - 1;
 
-  return binary_search(sb_begin, num_super_blocks() - 1, not_enough);
-}
+  if (select_sample_rate > 0) {
+    // The answer is between the super blocks of the surrounding samples.
+    const auto& samples = select_samples[B];
+    const auto sample_idx = (nth - 1) / select_sample_rate;
+    assert(sample_idx < std::ssize(samples));
 
-namespace {
-
-/// Sequentially searches for the nth bit set to B.
-///
-/// \pre The nth bit must exist in the range of blocks.
-///
-/// \returns The position of the found bit, measured in bits. That is, the
-/// position of the bit in the containing block plus `size_in_bits<T>`
-/// multiplied by the number of preceding blocks.
-///
-template <bool B, large_unsigned_integer T>
-constexpr index_type sequential_select(const std::span<const T> blocks,
-                                       const size_type nth) {
-  assert(nth > 0);
+    sb_first = std::max(sb_first, samples[sample_idx]);
+    if (sample_idx + 1 < std::ssize(samples)) {
+      sb_last = samples[sample_idx + 1];
+    }
+  }
+  return {sb_first, sb_last};
+}
 
-  size_type sum = 0;
-  for (index_type i = 0; i < std::ssize(blocks); ++i) {
-    const auto& elem = blocks[i];
+/// Finds the super block that contains the nth bit equal to B.
+template <typename Layout>
+template <bool B>
+auto basic_bitmap<Layout>::sb_select(const size_type nth) const noexcept
+    -> index_type {
+  const auto [sb_first, sb_last] = sb_select_range<B>(nth);
+
+  // Note that binary_search never evaluates the last super block, so the
+  // padding bits of the last block are never counted as zeros.
+  auto not_enough = [&](const index_type sb_idx) {
+    return sb_exclusive_rank<B>(sb_idx + 1) < nth;
+  };
+  return binary_search(sb_first, sb_last, not_enough);
+}
 
-    const auto prev_sum = sum;
-    sum += count<B>(elem);
+/// Finds the nth bit equal to B within the super block `sb_idx`.
+template <typename Layout>
+template <bool B>
+auto basic_bitmap<Layout>::select_in_super_block(const index_type sb_idx,
+                                                 size_type nth) const noexcept
+    -> index_type {
+  assert(sb_idx >= 0 && sb_idx < num_super_blocks());
+  assert(nth > 0 && nth <= bits_per_super_block);
 
-    if (sum >= nth) {
-      assert(nth > prev_sum);
-      return i * size_in_bits<T> +
-             select<B>(elem, static_cast<int>(nth - prev_sum));
+  const auto blocks = blocks_of_super_block(sb_idx);
+  index_type block_idx = 0;
+  if constexpr (Layout::block_counters) {
+    // The relative ranks are enough to find the block, so only the block that
+    // contains the answer is read.
+    auto not_enough = [&](const index_type idx) {
+      return block_exclusive_rank<B>(sb_idx, idx + 1) < nth;
+    };
+    block_idx =
+        binary_search(index_type{0}, std::ssize(blocks) - 1, not_enough);
+    nth -= block_exclusive_rank<B>(sb_idx, block_idx);
+  } else {
+    // Note that the padding bits of the last block are counted as zeros, but
+    // the answer always precedes them.
+    for (; count<B>(blocks[block_idx]) < nth; ++block_idx) {
+      assert(block_idx + 1 < std::ssize(blocks));
+      nth -= count<B>(blocks[block_idx]);
     }
   }
-  return index_npos;
-}
+  assert(nth > 0 && nth <= bits_per_block);
 
-} // namespace
+  return sb_idx * bits_per_super_block + block_idx * bits_per_block +
+         brwt::select<B>(blocks[block_idx], static_cast<int>(nth));
+}
 
 /// Templated version of select_1 and select_0.
+template <typename Layout>
 template <bool B>
-auto bitmap::select(size_type nth) const noexcept -> index_type {
+auto basic_bitmap<Layout>::select(const size_type nth) const noexcept
+    -> index_type {
   assert(nth > 0);
 
   if (nth > num_of<B>()) {
@@ -239,21 +652,241 @@ auto bitmap::select(size_type nth) const noexcept -> index_type {
   const auto sb_idx = sb_select<B>(nth);
   assert(sb_idx < num_super_blocks());
 
-  nth -= sb_exclusive_rank<B>(sb_idx);
-  assert(nth > 0 && nth <= bits_per_super_block);
-
-  return sb_idx * bits_per_super_block +
-         sequential_select<B>(blocks_of_super_block(sb_idx), nth);
+  return select_in_super_block<B>(sb_idx, nth - sb_exclusive_rank<B>(sb_idx));
 }
 
-auto bitmap::select_1(size_type nth) const noexcept -> index_type {
+template <typename Layout>
+auto basic_bitmap<Layout>::select_1(size_type nth) const noexcept
+    -> index_type {
   assert(nth > 0);
   return select<1>(nth);
 }
 
-auto bitmap::select_0(size_type nth) const noexcept -> index_type {
+template <typename Layout>
+auto basic_bitmap<Layout>::select_0(size_type nth) const noexcept
+    -> index_type {
   assert(nth > 0);
   return select<0>(nth);
 }
 
+// Batched queries ----------------------
+
+/// Prefetches the rank entry and the data of the super block `sb_idx`.
+template <typename Layout>
+void basic_bitmap<Layout>::prefetch_super_block(
+    const index_type sb_idx) const noexcept {
+  const auto blocks = blocks_of_super_block(sb_idx);
+  if (const auto* entry = rank_dir.address_of(sb_idx); entry != nullptr) {
+    prefetch(entry);
+  }
+  prefetch(&blocks.front());
+  prefetch(&blocks.back()); // The data may straddle two cache lines.
+}
+
+template <typename Layout>
+void basic_bitmap<Layout>::rank_1(
+    const std::span<const index_type> positions,
+    const std::span<size_type> out) const noexcept {
+  assert(positions.size() == out.size());
+
+  // Software pipeline: the query batch_size positions ahead is prefetched
+  // while the current one is answered.
+  auto prefetch_rank = [&](const index_type pos) {
+    assert(pos >= 0 && pos < size());
+    const auto sb_idx = pos / bits_per_super_block;
+    if (const auto* entry = rank_dir.address_of(sb_idx); entry != nullptr) {
+      prefetch(entry);
+    }
+    prefetch(&bit_seq.get_blocks()[pos / bits_per_block]);
+  };
+  for (std::size_t i = 0; i < std::min(batch_size, positions.size()); ++i) {
+    prefetch_rank(positions[i]);
+  }
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    if (i + batch_size < positions.size()) {
+      prefetch_rank(positions[i + batch_size]);
+    }
+    out[i] = rank_1(positions[i]);
+  }
+}
+
+/// Templated version of the batched select_1 and select_0.
+template <typename Layout>
+template <bool B>
+void basic_bitmap<Layout>::select(
+    const std::span<const size_type> nths,
+    const std::span<index_type> out) const noexcept {
+  assert(nths.size() == out.size());
+
+  // Each group of queries is answered in stages, so that the loads of every
+  // stage are issued for the whole group before any of them is needed: the
+  // select samples, then each step of the super block search, then the search
+  // within the super block.
+  std::array<index_type, batch_size> sb_first{};
+  std::array<index_type, batch_size> sb_last{};
+  for (std::size_t first = 0; first < nths.size(); first += batch_size) {
+    const auto group = nths.subspan(first).first(
+        std::min(batch_size, nths.size() - first));
+    auto is_valid = [&](const size_type nth) {
+      assert(nth > 0);
+      return nth <= num_of<B>();
+    };
+
+    if (select_sample_rate > 0) {
+      for (const auto nth : group) {
+        if (is_valid(nth)) {
+          prefetch(&select_samples[B][(nth - 1) / select_sample_rate]);
+        }
+      }
+    }
+    for (std::size_t i = 0; i < group.size(); ++i) {
+      if (is_valid(group[i])) {
+        const auto [range_first, range_last] = sb_select_range<B>(group[i]);
+        sb_first[i] = range_first;
+        sb_last[i] = range_last;
+      } else {
+        sb_first[i] = sb_last[i] = 0;
+      }
+    }
+
+    // The binary searches of sb_select run in lockstep: the rank entries of
+    // the next step are prefetched for every query, then the step is taken.
+    auto mid = [&](const std::size_t i) {
+      return sb_first[i] + (sb_last[i] - sb_first[i]) / 2;
+    };
+    for (bool searching = true; searching;) {
+      for (std::size_t i = 0; i < group.size(); ++i) {
+        if (sb_first[i] != sb_last[i]) {
+          if (const auto* entry = rank_dir.address_of(mid(i) + 1);
+              entry != nullptr) {
+            prefetch(entry);
+          }
+        }
+      }
+      searching = false;
+      for (std::size_t i = 0; i < group.size(); ++i) {
+        if (sb_first[i] == sb_last[i]) {
+          continue;
+        }
+        const auto sb_idx = mid(i);
+        if (sb_exclusive_rank<B>(sb_idx + 1) < group[i]) {
+          sb_first[i] = sb_idx + 1;
+        } else {
+          sb_last[i] = sb_idx;
+        }
+        searching = searching || sb_first[i] != sb_last[i];
+      }
+    }
+
+    for (std::size_t i = 0; i < group.size(); ++i) {
+      if (is_valid(group[i])) {
+        prefetch_super_block(sb_first[i]);
+      }
+    }
+    for (std::size_t i = 0; i < group.size(); ++i) {
+      const auto nth = group[i];
+      out[first + i] =
+          is_valid(nth)
+              ? select_in_super_block<B>(
+                    sb_first[i], nth - sb_exclusive_rank<B>(sb_first[i]))
+              : index_npos;
+    }
+  }
+}
+
+template <typename Layout>
+void basic_bitmap<Layout>::select_1(
+    const std::span<const size_type> nths,
+    const std::span<index_type> out) const noexcept {
+  select<1>(nths, out);
+}
+
+template <typename Layout>
+void basic_bitmap<Layout>::select_0(
+    const std::span<const size_type> nths,
+    const std::span<index_type> out) const noexcept {
+  select<0>(nths, out);
+}
+
+/// Templated version of select_next_1 and select_next_0.
+template <typename Layout>
+template <bool B>
+auto basic_bitmap<Layout>::select_next(const index_type pos) const noexcept
+    -> index_type {
+  assert(pos >= 0 && pos <= size());
+
+  if (pos == size()) {
+    return index_npos;
+  }
+
+  // Scan the remaining words of the super block. They share the cache line of
+  // the word that contains pos, so this is cheaper than a rank plus a select.
+  const auto sb_idx = pos / bits_per_super_block;
+  const auto blocks = blocks_of_super_block(sb_idx);
+  auto block_idx = (pos % bits_per_super_block) / bits_per_block;
+
+  auto word = matching_bits<B>(blocks[block_idx]) &
+              (~word_type{0} << (pos % bits_per_block));
+  while (word == 0 && ++block_idx < std::ssize(blocks)) {
+    word = matching_bits<B>(blocks[block_idx]);
+  }
+  if (word != 0) {
+    const auto found = sb_idx * bits_per_super_block +
+                       block_idx * bits_per_block + std::countr_zero(word);
+    // The padding bits of the last block are seen as zeros.
+    return found < size() ? found : index_npos;
+  }
+
+  // Otherwise, the answer is the first bit equal to B of the following super
+  // blocks.
+  return select<B>(sb_exclusive_rank<B>(sb_idx + 1) + 1);
+}
+
+template <typename Layout>
+auto basic_bitmap<Layout>::select_next_1(const index_type pos) const noexcept
+    -> index_type {
+  return select_next<1>(pos);
+}
+
+template <typename Layout>
+auto basic_bitmap<Layout>::select_next_0(const index_type pos) const noexcept
+    -> index_type {
+  return select_next<0>(pos);
+}
+
+// Explicit instantiations ----------------------
+
+template class basic_bitmap<rank_layout<4, counter_width::packed, false>>;
+template class basic_bitmap<rank_layout<4, counter_width::bits32, false>>;
+template class basic_bitmap<rank_layout<4, counter_width::bits32, true>>;
+template class basic_bitmap<rank_layout<4, counter_width::bits64, false>>;
+template class basic_bitmap<rank_layout<4, counter_width::bits64, true>>;
+template class basic_bitmap<
+    rank_layout<4, counter_width::relative16, false>>;
+template class basic_bitmap<
+    rank_layout<4, counter_width::relative32, false>>;
+template class basic_bitmap<rank_layout<8, counter_width::packed, false>>;
+template class basic_bitmap<rank_layout<8, counter_width::bits32, false>>;
+template class basic_bitmap<rank_layout<8, counter_width::bits32, true>>;
+template class basic_bitmap<rank_layout<8, counter_width::bits64, false>>;
+template class basic_bitmap<rank_layout<8, counter_width::bits64, true>>;
+template class basic_bitmap<
+    rank_layout<8, counter_width::relative16, false>>;
+template class basic_bitmap<
+    rank_layout<8, counter_width::relative32, false>>;
+template class basic_bitmap<rank_layout<16, counter_width::packed, false>>;
+template class basic_bitmap<rank_layout<16, counter_width::bits32, false>>;
+template class basic_bitmap<rank_layout<16, counter_width::bits64, false>>;
+template class basic_bitmap<
+    rank_layout<16, counter_width::relative16, false>>;
+template class basic_bitmap<
+    rank_layout<16, counter_width::relative32, false>>;
+template class basic_bitmap<rank_layout<32, counter_width::packed, false>>;
+template class basic_bitmap<rank_layout<32, counter_width::bits32, false>>;
+template class basic_bitmap<rank_layout<32, counter_width::bits64, false>>;
+template class basic_bitmap<
+    rank_layout<32, counter_width::relative16, false>>;
+template class basic_bitmap<
+    rank_layout<32, counter_width::relative32, false>>;
+
 } // namespace brwt
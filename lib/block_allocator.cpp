@@ -0,0 +1,81 @@
+#include "brwt/block_allocator.h"
+#include "brwt/utility.h"
+#include <cstddef>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#define BRWT_HAS_HUGE_PAGES 1
+#endif
+
+namespace brwt {
+
+namespace {
+
+constexpr auto alignment = std::align_val_t{block_alignment};
+
+#if defined(BRWT_HAS_HUGE_PAGES)
+
+/// Size of a huge page on x86-64 and most aarch64 configurations. Smaller
+/// allocations are not worth a mapping of their own.
+constexpr std::size_t huge_page_size = std::size_t{1} << 21;
+
+bool uses_mapping(const std::size_t bytes,
+                  const allocation_policy policy) noexcept {
+  return policy == allocation_policy::huge_pages && bytes >= huge_page_size;
+}
+
+std::size_t mapping_size(const std::size_t bytes) noexcept {
+  return ceil_div(bytes, huge_page_size) * huge_page_size;
+}
+
+void* map_huge_pages(const std::size_t bytes) {
+  const auto len = mapping_size(bytes);
+  constexpr int prot = PROT_READ | PROT_WRITE;
+  constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+  // Explicit huge pages are only available if the administrator reserved
+  // them, so failing here is expected.
+  void* ptr = mmap(nullptr, len, prot, flags | MAP_HUGETLB, -1, 0);
+  if (ptr != MAP_FAILED) {
+    return ptr;
+  }
+  ptr = mmap(nullptr, len, prot, flags, -1, 0);
+  if (ptr == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  // Transparent huge pages are just a hint. The memory is valid either way.
+  static_cast<void>(madvise(ptr, len, MADV_HUGEPAGE));
+  return ptr;
+}
+
+#endif // BRWT_HAS_HUGE_PAGES
+
+} // namespace
+
+void* detail::allocate_blocks(const std::size_t bytes,
+                              const allocation_policy policy) {
+#if defined(BRWT_HAS_HUGE_PAGES)
+  if (uses_mapping(bytes, policy)) {
+    return map_huge_pages(bytes);
+  }
+#else
+  static_cast<void>(policy);
+#endif
+  return ::operator new(bytes, alignment);
+}
+
+void detail::deallocate_blocks(void* const ptr, const std::size_t bytes,
+                               const allocation_policy policy) noexcept {
+#if defined(BRWT_HAS_HUGE_PAGES)
+  if (uses_mapping(bytes, policy)) {
+    munmap(ptr, mapping_size(bytes));
+    return;
+  }
+#else
+  static_cast<void>(policy);
+#endif
+  ::operator delete(ptr, bytes, alignment);
+}
+
+} // namespace brwt
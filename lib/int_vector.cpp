@@ -1,12 +1,20 @@
 #include "brwt/int_vector.h"
 #include "brwt/bit_ops.h"
 #include "brwt/bit_vector.h"
+#include "brwt/block_allocator.h"
+#include "brwt/common_types.h"
+#include "brwt/detail/bit_packing.h"
+#include "brwt/image.h"
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstddef>
 #include <initializer_list>
 #include <iterator>
 #include <limits>
+#include <span>
 #include <stdexcept>
+#include <utility>
 
 namespace brwt {
 
@@ -26,6 +34,36 @@ int needed_bits(const InputRange& range) {
   return needed_bits(std::begin(range), std::end(range));
 }
 
+// Bulk access kernels ----------------------
+
+using value_type = int_vector::value_type;
+using detail::elems_per_group;
+
+using unpack_kernel = void (*)(const value_type*, value_type*,
+                               size_type) noexcept;
+using pack_kernel = void (*)(const value_type*, bit_vector&, size_type,
+                             size_type) noexcept;
+
+/// Kernels indexed by the number of bits per element minus one.
+template <std::size_t... I>
+constexpr auto make_unpack_kernels(std::index_sequence<I...>) noexcept {
+  return std::array<unpack_kernel, sizeof...(I)>{
+      &detail::unpack_groups<static_cast<int>(I) + 1>...};
+}
+
+template <std::size_t... I>
+constexpr auto make_pack_kernels(std::index_sequence<I...>) noexcept {
+  return std::array<pack_kernel, sizeof...(I)>{
+      &detail::pack_groups<static_cast<int>(I) + 1>...};
+}
+
+constexpr auto max_bpe = detail::bits_per_packed_block - 1;
+
+constexpr auto unpack_kernels =
+    make_unpack_kernels(std::make_index_sequence<max_bpe>{});
+constexpr auto pack_kernels =
+    make_pack_kernels(std::make_index_sequence<max_bpe>{});
+
 } // namespace
 
 auto int_vector::set_value(const size_type pos, const value_type value) noexcept
@@ -48,7 +86,8 @@ auto int_vector::non_const(const_iterator pos) noexcept -> iterator {
   return begin() + index_of(pos);
 }
 
-int_vector::int_vector(const size_type count, const int bpe)
+int_vector::int_vector(const size_type count, const int bpe,
+                       const allocator_type& alloc)
     : num_elems{count}, bits_per_element{bpe} {
   assert(count >= 0);
   assert(bpe >= 0);
@@ -58,13 +97,84 @@ int_vector::int_vector(const size_type count, const int bpe)
     throw std::domain_error("int_vector: Too many bits per element");
   }
 
-  bit_seq = bit_vector(num_elems * bits_per_element);
+  bit_seq = bit_vector(num_elems * bits_per_element, alloc);
+}
+
+void int_vector::save(image& img) const {
+  img.push_back(static_cast<word_type>(num_elems));
+  img.push_back(static_cast<word_type>(bits_per_element));
+  bit_seq.save(img);
+}
+
+int_vector int_vector::view(image_reader& reader) {
+  int_vector result;
+  result.num_elems = static_cast<size_type>(reader.read_word());
+  result.bits_per_element = static_cast<size_type>(reader.read_word());
+  result.bit_seq = bit_vector::view(reader);
+
+  constexpr auto bits_per_block = std::numeric_limits<value_type>::digits;
+  if (result.num_elems < 0 || result.bits_per_element < 0 ||
+      result.bits_per_element >= bits_per_block ||
+      result.bit_seq.size() != result.num_elems * result.bits_per_element) {
+    throw std::length_error("image: Corrupted int vector");
+  }
+  return result;
 }
 
 int_vector::int_vector(std::initializer_list<value_type> ilist)
     : int_vector(static_cast<size_type>(ilist.size()), needed_bits(ilist)) {
 
-  std::copy(ilist.begin(), ilist.end(), begin());
+  encode(0, {ilist.begin(), ilist.size()});
+}
+
+void int_vector::decode(const size_type first,
+                        const std::span<value_type> out) const noexcept {
+  const auto count = std::ssize(out);
+  assert(first >= 0 && first + count <= size());
+  if (bits_per_element == 0) {
+    std::fill(out.begin(), out.end(), value_type{0});
+    return;
+  }
+
+  const auto split = detail::split_groups(first, count);
+  auto* dst = out.data();
+  auto pos = first;
+  for (size_type i = 0; i < split.head; ++i) {
+    *dst++ = get_value(pos++);
+  }
+  const auto* blocks = bit_seq.get_blocks().data() +
+                       pos / elems_per_group * bits_per_element;
+  unpack_kernels[static_cast<std::size_t>(bits_per_element - 1)](
+      blocks, dst, split.num_groups);
+  dst += split.num_groups * elems_per_group;
+  pos += split.num_groups * elems_per_group;
+  for (size_type i = 0; i < split.tail; ++i) {
+    *dst++ = get_value(pos++);
+  }
+}
+
+void int_vector::encode(const size_type first,
+                        const std::span<const value_type> values) noexcept {
+  const auto count = std::ssize(values);
+  assert(first >= 0 && first + count <= size());
+  if (bits_per_element == 0) {
+    return;
+  }
+
+  const auto split = detail::split_groups(first, count);
+  const auto* src = values.data();
+  auto pos = first;
+  for (size_type i = 0; i < split.head; ++i) {
+    set_value(pos++, *src++);
+  }
+  pack_kernels[static_cast<std::size_t>(bits_per_element - 1)](
+      src, bit_seq, pos / elems_per_group * bits_per_element,
+      split.num_groups);
+  src += split.num_groups * elems_per_group;
+  pos += split.num_groups * elems_per_group;
+  for (size_type i = 0; i < split.tail; ++i) {
+    set_value(pos++, *src++);
+  }
 }
 
 auto int_vector::erase(const_iterator pos) noexcept -> iterator {
@@ -76,11 +186,78 @@ auto int_vector::erase(const_iterator first, const_iterator last) noexcept
     -> iterator {
   assert(first >= begin() && first <= last && last <= end());
 
-  // Note that num_elems must be updated at the end because of cend() usage.
-  const auto new_end = std::copy(last, cend(), non_const(first));
-  num_elems = index_of(new_end);
+  // The following elements are shifted as a single range of bits.
+  const auto first_idx = index_of(first);
+  const auto last_idx = index_of(last);
+  bit_seq.copy_bits(bit_seq, last_idx * bits_per_element,
+                    first_idx * bits_per_element,
+                    (num_elems - last_idx) * bits_per_element);
+  num_elems -= last_idx - first_idx;
+  bit_seq.resize(num_elems * bits_per_element);
+
+  return begin() + first_idx;
+}
+
+auto int_vector::capacity() const noexcept -> size_type {
+  if (bits_per_element == 0) {
+    return std::numeric_limits<size_type>::max();
+  }
+  return bit_seq.capacity() / bits_per_element;
+}
+
+void int_vector::push_back(const value_type value) {
+  bit_seq.resize((num_elems + 1) * bits_per_element);
+  ++num_elems;
+  set_value(num_elems - 1, value);
+}
 
-  return non_const(first);
+void int_vector::reserve(const size_type count) {
+  bit_seq.reserve(count * bits_per_element);
+}
+
+void int_vector::resize(const size_type count) {
+  assert(count >= 0);
+  bit_seq.resize(count * bits_per_element);
+  num_elems = count;
+}
+
+void int_vector::shrink_to_fit() {
+  bit_seq.shrink_to_fit();
+}
+
+bool operator==(const int_vector& lhs, const int_vector& rhs) noexcept {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  if (lhs.get_bpe() == rhs.get_bpe()) {
+    // Equal layouts, so compare the used bits a block at a time.
+    const auto num_bits = lhs.size() * lhs.get_bpe();
+    const auto full_blocks = num_bits / bit_vector::bits_per_block;
+    const auto rest = num_bits % bit_vector::bits_per_block;
+    const auto lhs_blocks = lhs.bit_seq.get_blocks();
+    const auto rhs_blocks = rhs.bit_seq.get_blocks();
+    return std::equal(lhs_blocks.begin(), lhs_blocks.begin() + full_blocks,
+                      rhs_blocks.begin()) &&
+           lhs.bit_seq.get_chunk(num_bits - rest, rest) ==
+               rhs.bit_seq.get_chunk(num_bits - rest, rest);
+  }
+
+  // Decode both sides in batches that fit in the L1 cache.
+  constexpr size_type batch_size = 512;
+  std::array<value_type, batch_size> lhs_batch;
+  std::array<value_type, batch_size> rhs_batch;
+  for (size_type first = 0; first < lhs.size(); first += batch_size) {
+    const auto count = std::min(batch_size, lhs.size() - first);
+    const auto len = static_cast<std::size_t>(count);
+    const auto lhs_values = std::span(lhs_batch).first(len);
+    const auto rhs_values = std::span(rhs_batch).first(len);
+    lhs.decode(first, lhs_values);
+    rhs.decode(first, rhs_values);
+    if (!std::ranges::equal(lhs_values, rhs_values)) {
+      return false;
+    }
+  }
+  return true;
 }
 
 } // end namespace brwt
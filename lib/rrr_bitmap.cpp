@@ -0,0 +1,266 @@
+#include "brwt/rrr_bitmap.h"
+#include "generic_algorithms.h"
+#include "brwt/bit_ops.h"
+#include "brwt/bit_vector.h"
+#include "brwt/common_types.h"
+#include "brwt/int_vector.h"
+#include "brwt/utility.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace brwt {
+
+namespace {
+
+constexpr int bits_per_block = rrr_bitmap::bits_per_block;
+constexpr size_type blocks_per_super_block = rrr_bitmap::blocks_per_super_block;
+constexpr size_type bits_per_super_block =
+    blocks_per_super_block * bits_per_block;
+
+constexpr int num_classes = bits_per_block + 1;
+
+using binomial_table = std::array<std::array<word_type, num_classes>,
+                                  num_classes>;
+
+/// `binomial[n][k]` is the number of k-combinations of a set of n elements.
+constexpr binomial_table binomial = [] {
+  binomial_table table{};
+  for (int n = 0; n < num_classes; ++n) {
+    table[n][0] = 1;
+    for (int k = 1; k <= n; ++k) {
+      table[n][k] = table[n - 1][k - 1] + table[n - 1][k];
+    }
+  }
+  return table;
+}();
+
+/// Number of bits used by the offset of a block of each class.
+constexpr std::array<int, num_classes> offset_bits = [] {
+  std::array<int, num_classes> bits{};
+  for (int c = 0; c < num_classes; ++c) {
+    bits[c] = used_bits(binomial[bits_per_block][c] - 1);
+  }
+  return bits;
+}();
+
+/// Position in the decode table of the first block of each class.
+constexpr std::array<word_type, num_classes> class_begin = [] {
+  std::array<word_type, num_classes> begin{};
+  for (int c = 1; c < num_classes; ++c) {
+    begin[c] = begin[c - 1] + binomial[bits_per_block][c - 1];
+  }
+  return begin;
+}();
+
+/// Computes the offset of a block, which is its index among the blocks of
+/// the same class in increasing order. It follows the combinatorial number
+/// system: the j-th set bit (counting from 1) at position p contributes
+/// `binomial[p][j]`.
+///
+constexpr word_type encode(word_type value) noexcept {
+  word_type offset = 0;
+  for (int j = 1; value != 0; ++j) {
+    const auto pos = std::countr_zero(value);
+    offset += binomial[pos][j];
+    value &= value - 1;
+  }
+  return offset;
+}
+
+static_assert(encode(0b000) == 0);
+static_assert(encode(0b001) == 0);
+static_assert(encode(0b010) == 1);
+static_assert(encode(0b100) == 2);
+static_assert(encode(0b011) == 0);
+static_assert(encode(0b101) == 1);
+static_assert(encode(0b110) == 2);
+
+/// Returns the table that maps <tt>class_begin[c] + offset</tt> to the block
+/// of class `c` with the given offset.
+///
+const auto& decode_table() noexcept {
+  constexpr auto table_size = std::size_t{1} << bits_per_block;
+  using table_type = std::array<std::uint16_t, table_size>;
+  static const table_type table = [] {
+    table_type t{};
+    for (word_type value = 0; value < t.size(); ++value) {
+      const auto c = std::popcount(value);
+      t[class_begin[c] + encode(value)] = static_cast<std::uint16_t>(value);
+    }
+    return t;
+  }();
+  return table;
+}
+
+word_type read_block(const bit_vector& vec, const index_type block_idx) {
+  const auto pos = block_idx * bits_per_block;
+  return vec.get_chunk(pos, std::min<size_type>(bits_per_block,
+                                                vec.size() - pos));
+}
+
+int bits_for(const size_type max_value) noexcept {
+  return std::max(1, used_bits(static_cast<word_type>(max_value)));
+}
+
+template <bool B>
+constexpr int count(const word_type block_class) noexcept {
+  const auto c = static_cast<int>(block_class);
+  return B ? c : bits_per_block - c;
+}
+
+template <bool B>
+int select_in_block(const word_type block, const int nth) noexcept {
+  if constexpr (B) {
+    return select_1(block, nth);
+  } else {
+    return select_0(block, nth);
+  }
+}
+
+} // namespace
+
+rrr_bitmap::rrr_bitmap(const bit_vector& vec) : m_size{vec.size()} {
+  const auto count = ceil_div(m_size, size_type{bits_per_block});
+  m_classes = int_vector(count, used_bits(word_type{bits_per_block}));
+
+  // The first pass computes the classes and the size of the offsets.
+  size_type total_offset_bits = 0;
+  for (index_type i = 0; i < count; ++i) {
+    const auto c = std::popcount(read_block(vec, i));
+    m_classes[i] = static_cast<word_type>(c);
+    m_num_ones += c;
+    total_offset_bits += offset_bits[c];
+  }
+
+  const auto num_sb = ceil_div(count, blocks_per_super_block);
+  m_offsets = bit_vector(total_offset_bits);
+  m_sb_rank = int_vector(num_sb, bits_for(m_num_ones));
+  m_sb_offset = int_vector(num_sb, bits_for(total_offset_bits));
+
+  // The second pass fills the offsets and the super block samples.
+  size_type rank = 0;
+  index_type offset_pos = 0;
+  for (index_type i = 0; i < count; ++i) {
+    if (i % blocks_per_super_block == 0) {
+      m_sb_rank[i / blocks_per_super_block] = static_cast<word_type>(rank);
+      m_sb_offset[i / blocks_per_super_block] =
+          static_cast<word_type>(offset_pos);
+    }
+    const auto value = read_block(vec, i);
+    const auto c = std::popcount(value);
+    if (offset_bits[c] != 0) {
+      m_offsets.set_chunk(offset_pos, offset_bits[c], encode(value));
+      offset_pos += offset_bits[c];
+    }
+    rank += c;
+  }
+  assert(rank == m_num_ones);
+  assert(offset_pos == total_offset_bits);
+}
+
+auto rrr_bitmap::allocated_bytes() const noexcept -> size_type {
+  return m_classes.allocated_bytes() + m_offsets.allocated_bytes() +
+         m_sb_rank.allocated_bytes() + m_sb_offset.allocated_bytes();
+}
+
+/// Computes the rank and the offset position of the given block by walking
+/// the classes from the start of its super block.
+auto rrr_bitmap::locate(const index_type block_idx) const noexcept
+    -> block_position {
+  assert(block_idx >= 0 && block_idx < num_blocks());
+
+  const auto sb_idx = block_idx / blocks_per_super_block;
+  auto rank = static_cast<size_type>(m_sb_rank[sb_idx]);
+  auto offset_pos = static_cast<index_type>(m_sb_offset[sb_idx]);
+
+  for (auto i = sb_idx * blocks_per_super_block; i < block_idx; ++i) {
+    const auto c = m_classes[i];
+    rank += static_cast<size_type>(c);
+    offset_pos += offset_bits[c];
+  }
+  return {block_idx, rank, offset_pos};
+}
+
+auto rrr_bitmap::decode(const block_position& block) const noexcept
+    -> word_type {
+  const auto c = m_classes[block.block_idx];
+  if (offset_bits[c] == 0) {
+    // The block is either all zeros or all ones, and m_offsets may be empty.
+    return decode_table()[class_begin[c]];
+  }
+  const auto offset = m_offsets.get_chunk(block.offset_pos, offset_bits[c]);
+  return decode_table()[class_begin[c] + offset];
+}
+
+auto rrr_bitmap::access(const index_type pos) const noexcept -> bool {
+  assert(pos >= 0 && pos < size());
+
+  const auto block = decode(locate(pos / bits_per_block));
+  return ((block >> (pos % bits_per_block)) & 1) != 0;
+}
+
+auto rrr_bitmap::rank_1(const index_type pos) const noexcept -> size_type {
+  assert(pos >= 0 && pos < size());
+
+  const auto location = locate(pos / bits_per_block);
+  const auto bit_idx = static_cast<int>(pos % bits_per_block);
+  return location.rank + brwt::rank_1(decode(location), bit_idx);
+}
+
+auto rrr_bitmap::rank_0(const index_type pos) const noexcept -> size_type {
+  return (pos + 1) - rank_1(pos);
+}
+
+template <bool B>
+auto rrr_bitmap::sb_exclusive_rank(const index_type sb_idx) const noexcept
+    -> size_type {
+  const auto ones = static_cast<size_type>(m_sb_rank[sb_idx]);
+  return B ? ones : sb_idx * bits_per_super_block - ones;
+}
+
+/// Templated version of select_1 and select_0.
+template <bool B>
+auto rrr_bitmap::select(const size_type nth) const noexcept -> index_type {
+  assert(nth > 0);
+
+  if (nth > (B ? num_ones() : num_zeros())) {
+    return index_npos; // The answer does not exist.
+  }
+
+  // Find the last super block with less than nth bits equal to B before it.
+  auto not_enough = [&](const index_type sb_idx) {
+    return sb_exclusive_rank<B>(sb_idx) < nth;
+  };
+  const auto sb_idx =
+      int_binary_search(index_type{1}, m_sb_rank.size(), not_enough) - 1;
+
+  auto rank = sb_exclusive_rank<B>(sb_idx);
+  auto offset_pos = static_cast<index_type>(m_sb_offset[sb_idx]);
+  for (auto i = sb_idx * blocks_per_super_block;; ++i) {
+    assert(i < num_blocks());
+    const auto c = m_classes[i];
+    if (rank + count<B>(c) >= nth) {
+      const auto block = decode({i, rank, offset_pos});
+      const auto n = static_cast<int>(nth - rank);
+      return i * bits_per_block + select_in_block<B>(block, n);
+    }
+    rank += count<B>(c);
+    offset_pos += offset_bits[c];
+  }
+}
+
+auto rrr_bitmap::select_1(const size_type nth) const noexcept -> index_type {
+  assert(nth > 0);
+  return select<true>(nth);
+}
+
+auto rrr_bitmap::select_0(const size_type nth) const noexcept -> index_type {
+  assert(nth > 0);
+  return select<false>(nth);
+}
+
+} // namespace brwt
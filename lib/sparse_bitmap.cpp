@@ -0,0 +1,298 @@
+#include "brwt/sparse_bitmap.h"
+#include "brwt/bit_ops.h"
+#include "brwt/bit_vector.h"
+#include "brwt/bitmap.h"
+#include "brwt/common_types.h"
+#include "brwt/image.h"
+#include "brwt/int_vector.h"
+#include "brwt/utility.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+namespace brwt {
+
+namespace {
+
+/// Chooses the number of low bits that minimizes the space of the encoding.
+int choose_low_bits(const size_type size, const size_type num_ones) noexcept {
+  if (num_ones == 0 || size <= num_ones) {
+    return 0;
+  }
+  return used_bits(static_cast<word_type>(size / num_ones)) - 1;
+}
+
+/// Number of set bits that a zero sample aims to skip.
+constexpr size_type ones_per_zero_sample = 32;
+
+/// Chooses the number of zeros per sample so that about ones_per_zero_sample
+/// set bits lie between two samples. Returns its base 2 logarithm.
+int choose_zero_sample_log2(const size_type num_zeros,
+                            const size_type num_ones) noexcept {
+  if (num_ones == 0) {
+    return 0;
+  }
+  const auto zeros_per_sample =
+      std::max<size_type>(1, num_zeros * ones_per_zero_sample / num_ones);
+  return used_bits(static_cast<word_type>(zeros_per_sample)) - 1;
+}
+
+/// Whether the Elias-Fano encoding takes less space than the sequence itself.
+bool encoding_pays_off(const size_type size, const size_type num_ones,
+                       const int low_bits) noexcept {
+  const auto high_bits = num_ones + (size >> low_bits) + 1;
+  const auto sample_bits = num_ones *
+                           used_bits(static_cast<word_type>(num_ones)) /
+                           ones_per_zero_sample;
+  return num_ones * low_bits + high_bits + sample_bits < size;
+}
+
+} // namespace
+
+sparse_bitmap::sparse_bitmap(const bit_vector& vec) : m_size{vec.size()} {
+  const auto blocks = vec.get_blocks();
+  m_num_ones = popcount(blocks);
+  m_low_bits = choose_low_bits(m_size, m_num_ones);
+
+  if (!encoding_pays_off(m_size, m_num_ones, m_low_bits)) {
+    m_plain = true;
+    m_low_bits = 0;
+    m_high = bitmap(vec);
+    return;
+  }
+  if (m_low_bits > 0) {
+    m_low = int_vector(m_num_ones, m_low_bits, vec.get_allocator());
+  }
+  bit_vector high(m_num_ones + (m_size >> m_low_bits) + 1,
+                  vec.get_allocator());
+
+  const auto low_mask = lsb_mask<word_type>(m_low_bits);
+  index_type idx = 0;
+  for (index_type i = 0; i < std::ssize(blocks); ++i) {
+    for (auto block = blocks[i]; block != 0; block &= block - 1) {
+      const auto pos = static_cast<word_type>(
+          i * bit_vector::bits_per_block + std::countr_zero(block));
+      if (m_low_bits > 0) {
+        m_low[idx] = pos & low_mask;
+      }
+      high.set(static_cast<index_type>(pos >> m_low_bits) + idx, true);
+      ++idx;
+    }
+  }
+  assert(idx == m_num_ones);
+
+  m_high = bitmap(std::move(high));
+  build_zero_samples(vec);
+}
+
+void sparse_bitmap::build_zero_samples(const bit_vector& vec) {
+  // Without set bits, select_0 needs no samples.
+  if (m_num_ones == 0) {
+    return;
+  }
+  m_zero_sample_log2 = choose_zero_sample_log2(num_zeros(), m_num_ones);
+  const auto rate = size_type{1} << m_zero_sample_log2;
+  m_zero_samples = int_vector(ceil_div(num_zeros(), rate),
+                              std::max(1, used_bits(static_cast<word_type>(
+                                              m_num_ones))),
+                              vec.get_allocator());
+
+  const auto blocks = vec.get_blocks();
+  size_type zeros_before = 0;
+  size_type next_sample = 0;
+  for (index_type i = 0; i < vec.num_blocks(); ++i) {
+    const auto block_first = i * bit_vector::bits_per_block;
+    const auto num_bits =
+        std::min(bit_vector::bits_per_block, m_size - block_first);
+    const auto block_zeros = num_bits - std::popcount(blocks[i]);
+
+    // The target is the 1-based number of the next sampled zero.
+    for (auto target = (next_sample << m_zero_sample_log2) + 1;
+         target <= zeros_before + block_zeros; target += rate) {
+      const auto offset =
+          brwt::select_0(blocks[i], static_cast<int>(target - zeros_before));
+      const auto pos = block_first + offset;
+      m_zero_samples[next_sample++] =
+          static_cast<word_type>(pos - (target - 1));
+    }
+    zeros_before += block_zeros;
+  }
+  assert(next_sample == m_zero_samples.size());
+}
+
+auto sparse_bitmap::allocated_bytes() const noexcept -> size_type {
+  return m_zero_samples.allocated_bytes() + m_low.allocated_bytes() +
+         m_high.allocated_bytes();
+}
+
+void sparse_bitmap::save(image& img) const {
+  img.push_back(static_cast<word_type>(m_size));
+  img.push_back(static_cast<word_type>(m_num_ones));
+  img.push_back(static_cast<word_type>(m_plain));
+  img.push_back(static_cast<word_type>(m_low_bits));
+  img.push_back(static_cast<word_type>(m_zero_sample_log2));
+  m_zero_samples.save(img);
+  m_low.save(img);
+  m_high.save(img);
+}
+
+auto sparse_bitmap::view(image_reader& reader) -> sparse_bitmap {
+  sparse_bitmap result;
+  result.m_size = static_cast<size_type>(reader.read_word());
+  result.m_num_ones = static_cast<size_type>(reader.read_word());
+  result.m_plain = reader.read_word() != 0;
+  result.m_low_bits = static_cast<int>(reader.read_word());
+  result.m_zero_sample_log2 = static_cast<int>(reader.read_word());
+  result.m_zero_samples = int_vector::view(reader);
+  result.m_low = int_vector::view(reader);
+  result.m_high = bitmap::view(reader);
+
+  auto corrupted = [&] {
+    const auto& r = result;
+    constexpr int max_log2 = bit_vector::bits_per_block - 2;
+    if (r.m_num_ones < 0 || r.m_num_ones > r.m_size || r.m_low_bits < 0 ||
+        r.m_low_bits > max_log2 || r.m_zero_sample_log2 < 0 ||
+        r.m_zero_sample_log2 > max_log2 ||
+        r.m_high.num_ones() != r.m_num_ones) {
+      return true;
+    }
+    if (r.m_plain) {
+      return r.m_high.size() != r.m_size || !r.m_zero_samples.empty() ||
+             !r.m_low.empty();
+    }
+    const auto num_samples =
+        r.m_num_ones == 0
+            ? 0
+            : ceil_div(r.num_zeros(), size_type{1} << r.m_zero_sample_log2);
+    return r.m_high.size() != r.m_num_ones + (r.m_size >> r.m_low_bits) + 1 ||
+           r.m_zero_samples.size() != num_samples ||
+           r.m_low.size() != (r.m_low_bits == 0 ? 0 : r.m_num_ones);
+  };
+  if (corrupted()) {
+    throw std::length_error("image: Corrupted sparse bitmap");
+  }
+  return result;
+}
+
+auto sparse_bitmap::low_part(const index_type idx) const noexcept
+    -> word_type {
+  return m_low_bits == 0 ? 0 : m_low[idx];
+}
+
+/// Returns the position of the idx-th set bit (0-based).
+auto sparse_bitmap::position_of(const index_type idx) const noexcept
+    -> index_type {
+  assert(idx >= 0 && idx < num_ones());
+
+  const auto high = static_cast<word_type>(m_high.select_1(idx + 1) - idx);
+  return static_cast<index_type>((high << m_low_bits) | low_part(idx));
+}
+
+/// Counts the set bits in positions less than `pos`.
+auto sparse_bitmap::count_less(const index_type pos) const noexcept
+    -> size_type {
+  assert(pos >= 0 && pos <= size());
+
+  const auto high = pos >> m_low_bits;
+  const auto low =
+      static_cast<word_type>(pos) & lsb_mask<word_type>(m_low_bits);
+
+  // Skip the buckets with lower high bits, then scan the bucket of `pos`.
+  auto high_pos = (high == 0) ? 0 : m_high.select_0(high) + 1;
+  auto idx = high_pos - high;
+  while (high_pos < m_high.size() && m_high.access(high_pos) &&
+         low_part(idx) < low) {
+    ++high_pos;
+    ++idx;
+  }
+  return idx;
+}
+
+auto sparse_bitmap::access(const index_type pos) const noexcept -> bool {
+  assert(pos >= 0 && pos < size());
+  if (m_plain) {
+    return m_high.access(pos);
+  }
+
+  const auto idx = count_less(pos);
+  return idx < num_ones() && position_of(idx) == pos;
+}
+
+auto sparse_bitmap::rank_1(const index_type pos) const noexcept -> size_type {
+  assert(pos >= 0 && pos < size());
+  if (m_plain) {
+    return m_high.rank_1(pos);
+  }
+  return count_less(pos + 1);
+}
+
+auto sparse_bitmap::rank_0(const index_type pos) const noexcept -> size_type {
+  return (pos + 1) - rank_1(pos);
+}
+
+auto sparse_bitmap::select_1(const size_type nth) const noexcept
+    -> index_type {
+  assert(nth > 0);
+
+  if (m_plain) {
+    return m_high.select_1(nth);
+  }
+  if (nth > num_ones()) {
+    return index_npos;
+  }
+  return position_of(nth - 1);
+}
+
+auto sparse_bitmap::select_0(const size_type nth) const noexcept
+    -> index_type {
+  assert(nth > 0);
+
+  if (m_plain) {
+    return m_high.select_0(nth);
+  }
+  if (nth > num_zeros()) {
+    return index_npos;
+  }
+  if (num_ones() == 0) {
+    return nth - 1;
+  }
+  // The idx-th set bit precedes the nth zero if and only if less than nth
+  // zeros precede it. The samples around the nth zero bound the number of
+  // such set bits. Long runs of set bits between them are narrowed down with
+  // a binary search, then the remaining set bits are walked on the high bits
+  // from a single select.
+  const auto sample = (nth - 1) >> m_zero_sample_log2;
+  auto first = static_cast<index_type>(m_zero_samples[sample]);
+  auto last = (sample + 1 < m_zero_samples.size())
+                  ? static_cast<index_type>(m_zero_samples[sample + 1])
+                  : num_ones();
+  auto precedes = [&](const index_type idx) {
+    return position_of(idx) - idx < nth;
+  };
+  while (last - first > ones_per_zero_sample) {
+    const auto mid = first + (last - first) / 2;
+    if (precedes(mid)) {
+      first = mid + 1;
+    } else {
+      last = mid;
+    }
+  }
+  if (first == last) {
+    return (nth - 1) + first;
+  }
+  auto idx = first;
+  for (const auto high_pos :
+       m_high.ones(m_high.select_1(first + 1), m_high.size())) {
+    const auto high = static_cast<word_type>(high_pos - idx);
+    const auto pos =
+        static_cast<index_type>((high << m_low_bits) | low_part(idx));
+    if (pos - idx >= nth || ++idx == last) {
+      break;
+    }
+  }
+  return (nth - 1) + idx;
+}
+
+} // namespace brwt
@@ -30,16 +30,6 @@ static const T& get_right(const std::pair<T, T>& p) {
 // node_proxy extensions
 // ==========================================
 
-static size_type inclusive_rank_0(const node_proxy& node,
-                                  const index_type pos) noexcept {
-  return node.rank_0(pos);
-}
-
-static size_type inclusive_rank_1(const node_proxy& node,
-                                  const index_type pos) noexcept {
-  return node.rank_1(pos);
-}
-
 static size_type exclusive_rank_0(const node_proxy& node,
                                   const index_type pos) noexcept {
   assert(pos >= 0 && pos <= node.size());
@@ -62,18 +52,13 @@ static size_type exclusive_rank_1(const node_proxy& node,
 // index_range, node_proxy extensions
 // ==========================================
 
-static auto before_end(const index_range& range) noexcept {
-  assert(size(range) > 0);
-  return end(range) - 1;
-}
-
 static auto make_lhs_range(const index_range& range,
                            const node_proxy& node) noexcept {
   assert(!empty(range));
   assert(begin(range) >= 0 && end(range) <= node.size());
 
-  return index_range{exclusive_rank_0(node, begin(range)),
-                     inclusive_rank_0(node, before_end(range))};
+  const auto [first, last] = node.rank_0(begin(range), end(range));
+  return index_range{first, last};
 }
 
 static auto make_rhs_range(const index_range& range,
@@ -81,8 +66,8 @@ static auto make_rhs_range(const index_range& range,
   assert(!empty(range));
   assert(begin(range) >= 0 && end(range) <= node.size());
 
-  return index_range{exclusive_rank_1(node, begin(range)),
-                     inclusive_rank_1(node, before_end(range))};
+  const auto [first, last] = node.rank_1(begin(range), end(range));
+  return index_range{first, last};
 }
 
 static auto make_rhs_range_using_lhs(const index_range& range,
@@ -177,11 +162,45 @@ size_type exclusive_rank(const wavelet_tree& wt, between<symbol_id> cond,
                         end_pos);
 }
 
+// Counts the symbols of the given node range that are less than or equal to
+// max_symbol. Both ends of the range are ranked together at each level.
+static size_type count_less_equal(node_proxy node, index_range range,
+                                  const symbol_id max_symbol) noexcept {
+  assert(begin(range) >= 0 && end(range) <= node.size());
+
+  size_type count = 0;
+  while (!empty(range)) {
+    const auto lhs_range = make_lhs_range(range, node);
+    if (node.is_lhs_symbol(max_symbol)) {
+      if (node.is_leaf()) {
+        return count + size(lhs_range);
+      }
+      range = lhs_range;
+      node = node.make_lhs();
+    } else {
+      if (node.is_leaf()) {
+        return count + size(range);
+      }
+      count += size(lhs_range);
+      range = make_rhs_range_using_lhs(range, lhs_range);
+      node = node.make_rhs();
+    }
+  }
+  return count;
+}
+
 size_type rank(const wavelet_tree& wt, const index_range range,
                const between<symbol_id> cond) noexcept {
-  // TODO(Diego): It can be implemented faster.
-  return exclusive_rank(wt, cond, end(range)) -
-         exclusive_rank(wt, cond, begin(range));
+  assert(begin(range) >= 0 && end(range) <= wt.size());
+  if (empty(range)) {
+    return 0;
+  }
+  const auto root = wt.make_root();
+  auto count = count_less_equal(root, range, cond.max_value);
+  if (cond.min_value != 0) {
+    count -= count_less_equal(root, range, prev(cond.min_value));
+  }
+  return count;
 }
 
 namespace count_symbols_detail {
@@ -451,32 +470,14 @@ static index_type make_rhs_start(const node_proxy& node,
 
 static index_type select_first_0(const node_proxy& node,
                                  const index_type start) noexcept {
-  // TODO(Jorge): Return node.select_next_0(pos) when available.
   assert(start >= 0 && start <= node.size());
-
-  if (start == node.size()) {
-    return index_npos;
-  }
-  if (!node.access(start)) {
-    return start;
-  }
-  const auto nth = exclusive_rank_0(node, start) + 1;
-  return node.select_0(nth);
+  return node.select_next_0(start);
 }
 
 static index_type select_first_1(const node_proxy& node,
                                  const index_type start) noexcept {
-  // TODO(Jorge): Return node.select_next_1(pos) when available.
   assert(start >= 0 && start <= node.size());
-
-  if (start == node.size()) {
-    return index_npos;
-  }
-  if (node.access(start)) {
-    return start;
-  }
-  const auto nth = exclusive_rank_1(node, start) + 1;
-  return node.select_1(nth);
+  return node.select_next_1(start);
 }
 
 static index_type
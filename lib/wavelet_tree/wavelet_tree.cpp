@@ -4,11 +4,16 @@
 #include "brwt/bit_vector.h"
 #include "brwt/bitmap.h"
 #include "brwt/common_types.h"
+#include "brwt/image.h"
 #include "brwt/int_vector.h"
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <limits>
 #include <numeric>
+#include <span>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -16,70 +21,158 @@
 using brwt::wavelet_tree;
 using node_proxy = wavelet_tree::node_proxy;
 
-// ==========================================
-// wavelet_tree implementation
-// ==========================================
-
-wavelet_tree::wavelet_tree(const int_vector& sequence)
-    : seq_len{sequence.size()}, bits_per_symbol{sequence.get_bpe()} {
-  assert(bits_per_symbol >= 1);
-  using std::size_t;
-  using value_type = int_vector::value_type;
-
-  // TODO(diegoramirez): Improve the constructor implementation. Consider
-  // representing the tree with a Wavelet matrix.
+namespace {
+
+using brwt::bit_vector;
+using brwt::size_type;
+using brwt::detail::symbol_source;
+using value_type = brwt::word_type;
+
+/// Calls `f` with each symbol of `source`, which is decoded in batches that fit
+/// in the L1 cache.
+template <typename Function>
+void for_each_symbol(const symbol_source& source, Function f) {
+  constexpr size_type batch_size = 512;
+  std::array<value_type, batch_size> batch;
+  for (size_type first = 0; first < source.size(); first += batch_size) {
+    const auto count = std::min(batch_size, source.size() - first);
+    const auto values = std::span(batch).first(static_cast<std::size_t>(count));
+    source.decode(first, values);
+    std::ranges::for_each(values, f);
+  }
+}
 
-  const auto alphabet_size = max_symbol_id() + 1;
+/// Widest symbols whose tree is built by `make_table`. The table takes 2^(Bits
+/// + 1) words, which is 256 MiB at this width.
+constexpr int max_table_bits = 24;
+
+/// Builds the levels of the wavelet tree of the symbols of `source`, which
+/// have `Bits` bits each.
+///
+/// The alphabet has 2^Bits symbols, so the node of each level is chosen by the
+/// next bit of the symbol, from the most significant one. The number of levels
+/// and the shifts are constants, so the loop is unrolled for each width.
+template <int Bits>
+bit_vector make_table(const symbol_source& source) {
+  static_assert(Bits >= 1 && Bits <= max_table_bits);
+  constexpr auto alphabet_size = value_type{1} << Bits;
+  const auto seq_len = source.size();
+
+  // next_pos[j] is the next position to fill in the node j, where the root is
+  // the node 1 and the children of j are 2 * j and 2 * j + 1. The leaves are
+  // first used to count the symbols.
   std::vector<size_type> next_pos(2 * alphabet_size);
-
-  for (const auto symbol : sequence) {
+  for_each_symbol(source, [&](const value_type symbol) {
     ++next_pos[alphabet_size + symbol];
-  }
+  });
   {
     const auto first = next_pos.begin() + static_cast<size_type>(alphabet_size);
     std::exclusive_scan(first, next_pos.end(), first, size_type{0});
   }
   for (auto j = alphabet_size - 1; j > 0; --j) {
-    const auto lhs = 2 * j; // rhs would be (2 * j + 1)
-    next_pos[j] = next_pos[lhs];
+    next_pos[j] = next_pos[2 * j];
   }
 
-  // Finally we can fill the table.
-  bit_vector bit_seq(bits_per_symbol * seq_len);
-
-  auto push_symbol = [&](const value_type symbol) {
+  bit_vector bit_seq(Bits * seq_len, source.get_allocator());
+  for_each_symbol(source, [&](const value_type symbol) {
     value_type j = 1;
-    value_type base_symbol = 0;
-    auto num_symbols = alphabet_size;
-    size_type level_pos = 0;
-
-    while (num_symbols > 1) {
-      const auto lhs_symbols = num_symbols / 2;
-      const bool is_lhs = (symbol < base_symbol + lhs_symbols);
-
-      bit_seq.set(level_pos + (next_pos[j]++), !is_lhs);
-
-      if (is_lhs) {
-        j = 2 * j;
-        // base_symbol = base_symbol; // does not change
-        num_symbols = lhs_symbols;
-      } else {
-        j = 2 * j + 1;
-        base_symbol = (base_symbol + lhs_symbols);
-        num_symbols = (num_symbols - lhs_symbols);
-      }
-      level_pos += seq_len;
+    for (int level = 0; level < Bits; ++level) {
+      const auto bit = (symbol >> (Bits - 1 - level)) & 1;
+      bit_seq.set(level * seq_len + (next_pos[j]++), bit != 0);
+      j = 2 * j + bit;
     }
     assert(j == alphabet_size + symbol);
-    assert(base_symbol == symbol);
-    assert(num_symbols == 1);
-    assert(level_pos == bit_seq.size());
-  };
-  for (const auto symbol : sequence) {
-    push_symbol(symbol);
+  });
+  return bit_seq;
+}
+
+/// Builds the levels of the wavelet tree of the symbols of `source` without
+/// a table indexed by symbol, so that any width can be used.
+///
+/// Each level holds the symbols sorted by their bits above the level. Hence,
+/// the nodes are runs of symbols with the same upper bits, and the order of
+/// the next level is a stable partition of each node by the bit of the level.
+bit_vector make_levels(const symbol_source& source) {
+  const int bits = source.bits_per_symbol();
+  const auto seq_len = source.size();
+
+  std::vector<value_type> seq;
+  seq.reserve(static_cast<std::size_t>(seq_len));
+  for_each_symbol(source,
+                  [&](const value_type symbol) { seq.push_back(symbol); });
+  std::vector<value_type> next(seq.size());
+
+  bit_vector bit_seq(bits * seq_len, source.get_allocator());
+  for (int level = 0; level < bits; ++level) {
+    const int shift = bits - 1 - level;
+    const auto level_pos = level * seq_len;
+    const auto node_of = [&](const value_type symbol) {
+      return symbol >> (shift + 1);
+    };
+    const auto bit_of = [&](const value_type symbol) {
+      return ((symbol >> shift) & 1) != 0;
+    };
+
+    std::size_t first = 0;
+    while (first != seq.size()) {
+      const auto node = node_of(seq[first]);
+      auto last = first + 1;
+      while (last != seq.size() && node_of(seq[last]) == node) {
+        ++last;
+      }
+      auto out = first;
+      for (auto i = first; i != last; ++i) {
+        if (bit_of(seq[i])) {
+          bit_seq.set(level_pos + static_cast<size_type>(i), true);
+        } else {
+          next[out++] = seq[i];
+        }
+      }
+      for (auto i = first; i != last; ++i) {
+        if (bit_of(seq[i])) {
+          next[out++] = seq[i];
+        }
+      }
+      first = last;
+    }
+    seq.swap(next);
   }
+  return bit_seq;
+}
+
+using table_builder = bit_vector (*)(const symbol_source&);
 
-  table = bitmap(std::move(bit_seq)); // The final magic.
+/// Builders indexed by the number of bits per symbol minus one.
+template <std::size_t... I>
+constexpr auto make_table_builders(std::index_sequence<I...>) noexcept {
+  return std::array<table_builder, sizeof...(I)>{
+      &make_table<static_cast<int>(I) + 1>...};
+}
+
+constexpr auto table_builders =
+    make_table_builders(std::make_index_sequence<max_table_bits>{});
+
+} // namespace
+
+// ==========================================
+// wavelet_tree implementation
+// ==========================================
+
+wavelet_tree::wavelet_tree(const int_vector& sequence)
+    : wavelet_tree(detail::symbol_source(sequence)) {}
+
+wavelet_tree::wavelet_tree(const detail::symbol_source& source)
+    : seq_len{source.size()}, bits_per_symbol{source.bits_per_symbol()} {
+  assert(bits_per_symbol >= 1);
+
+  // TODO(diegoramirez): Improve the constructor implementation. Consider
+  // representing the tree with a Wavelet matrix.
+  if (bits_per_symbol <= max_table_bits) {
+    const auto idx = static_cast<std::size_t>(bits_per_symbol - 1);
+    table = bitmap(table_builders[idx](source)); // The final magic.
+  } else {
+    table = bitmap(make_levels(source));
+  }
 }
 
 auto wavelet_tree::access(index_type pos) const noexcept -> symbol_id {
@@ -184,6 +277,27 @@ auto wavelet_tree::max_symbol_id() const noexcept -> symbol_id {
   return static_cast<symbol_id>(res);
 }
 
+void wavelet_tree::save(image& img) const {
+  img.push_back(static_cast<word_type>(seq_len));
+  img.push_back(static_cast<word_type>(bits_per_symbol));
+  table.save(img);
+}
+
+auto wavelet_tree::view(image_reader& reader) -> wavelet_tree {
+  wavelet_tree result;
+  result.seq_len = static_cast<size_type>(reader.read_word());
+  result.bits_per_symbol = static_cast<size_type>(reader.read_word());
+  result.table = bitmap::view(reader);
+
+  const auto bits = result.bits_per_symbol;
+  const auto max_bits = std::numeric_limits<word_type>::digits;
+  if (result.seq_len < 0 || bits < 0 || bits > max_bits ||
+      result.table.size() != result.seq_len * bits) {
+    throw std::length_error("image: Corrupted wavelet tree");
+  }
+  return result;
+}
+
 // ==========================================
 // node_proxy implementation
 // ==========================================
@@ -214,6 +328,26 @@ auto node_proxy::rank_1(const index_type pos) const noexcept -> size_type {
   return get_table().rank_1(begin() + pos) - ones_before();
 }
 
+// This function invokes the table range rank once.
+auto node_proxy::rank_0(const index_type first,
+                        const index_type last) const noexcept
+    -> std::pair<size_type, size_type> {
+  assert(first >= 0 && first <= last && last <= size());
+  const auto [first_zeros, last_zeros] =
+      get_table().rank_0(begin() + first, begin() + last);
+  return {first_zeros - zeros_before(), last_zeros - zeros_before()};
+}
+
+// This function invokes the table range rank once.
+auto node_proxy::rank_1(const index_type first,
+                        const index_type last) const noexcept
+    -> std::pair<size_type, size_type> {
+  assert(first >= 0 && first <= last && last <= size());
+  const auto [first_ones, last_ones] =
+      get_table().rank_1(begin() + first, begin() + last);
+  return {first_ones - ones_before(), last_ones - ones_before()};
+}
+
 auto node_proxy::select_0(const size_type nth) const noexcept -> index_type {
   assert(nth > 0);
   const auto abs_pos = get_table().select_0(zeros_before() + nth);
@@ -232,6 +366,26 @@ auto node_proxy::select_1(const size_type nth) const noexcept -> index_type {
   return abs_pos - begin();
 }
 
+auto node_proxy::select_next_0(const index_type pos) const noexcept
+    -> index_type {
+  assert(pos >= 0 && pos <= size());
+  const auto abs_pos = get_table().select_next_0(begin() + pos);
+  if (abs_pos == -1 || abs_pos >= end()) {
+    return -1;
+  }
+  return abs_pos - begin();
+}
+
+auto node_proxy::select_next_1(const index_type pos) const noexcept
+    -> index_type {
+  assert(pos >= 0 && pos <= size());
+  const auto abs_pos = get_table().select_next_1(begin() + pos);
+  if (abs_pos == -1 || abs_pos >= end()) {
+    return -1;
+  }
+  return abs_pos - begin();
+}
+
 // This function invokes table rank twice.
 auto node_proxy::make_lhs() const noexcept -> node_proxy {
   assert(!is_leaf());
@@ -255,23 +409,25 @@ auto node_proxy::make_rhs() const noexcept -> node_proxy {
                     /*level_mask_=*/(level_mask >> 1));
 }
 
-// This function invokes table rank thrice.
+// This function invokes table rank once and table range rank once.
 auto node_proxy::make_lhs_and_rhs() const noexcept
     -> std::pair<node_proxy, node_proxy> {
   const auto num_zeros = count_zeros();
   const auto lhs_first = begin() + wt_ptr->seq_len;
   const auto rhs_first = lhs_first + num_zeros;
+  const auto [lhs_ones_before, rhs_ones_before] =
+      get_table().rank_1(lhs_first, rhs_first);
   return {node_proxy(
               /*wt_=*/*wt_ptr,
               /*begin_=*/lhs_first,
               /*size_=*/num_zeros,
-              /*ones_before_=*/get_table().rank_1(lhs_first - 1),
+              /*ones_before_=*/lhs_ones_before,
               /*level_mask_=*/level_mask >> 1),
           node_proxy(
               /*wt_=*/*wt_ptr,
               /*begin_=*/rhs_first,
               /*size_=*/(size() - num_zeros),
-              /*ones_before_=*/get_table().rank_1(rhs_first - 1),
+              /*ones_before_=*/rhs_ones_before,
               /*level_mask_=*/(level_mask >> 1))};
 }
 
@@ -1,8 +1,10 @@
 #include "brwt/binary_relation.h"
 #include "brwt/common_types.h"
+#include "brwt/image.h"
 #include <doctest/doctest.h>
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <initializer_list>
 #include <optional>
 #include <ostream>
@@ -242,6 +244,45 @@ TEST_CASE("Vector of pairs constructor") {
   }
 }
 
+TEST_CASE("Vector of pairs constructor: long object ranges") {
+  // Objects with many labels take the radix sort path of the constructor.
+  constexpr size_type num_objects = 4;
+  constexpr size_type max_label = 70'000;
+  std::mt19937 engine{42};
+  std::uniform_int_distribution<size_type> gen_object{0, num_objects - 1};
+  std::uniform_int_distribution<size_type> gen_label{0, max_label};
+
+  std::vector<pair_type> pairs;
+  std::vector<std::vector<size_type>> labels(num_objects);
+  for (int i = 0; i < 20'000; ++i) {
+    const auto object = gen_object(engine);
+    // Some labels repeat to exercise the removal of duplicates.
+    const auto label = i % 3 == 0 ? gen_label(engine) % 100 : gen_label(engine);
+    pairs.push_back(pair(object_id(object), label_id(label)));
+    labels[static_cast<std::size_t>(object)].push_back(label);
+  }
+  size_type num_unique = 0;
+  for (auto& object_labels : labels) {
+    std::ranges::sort(object_labels);
+    const auto duplicates = std::ranges::unique(object_labels);
+    object_labels.erase(duplicates.begin(), duplicates.end());
+    num_unique += std::ssize(object_labels);
+  }
+
+  const binary_relation br(pairs);
+  REQUIRE(br.size() == num_unique);
+  for (size_type object = 0; object < num_objects; ++object) {
+    const auto& object_labels = labels[static_cast<std::size_t>(object)];
+    for (const size_type label : {size_type{0}, size_type{99}, size_type{500},
+                                  size_type{35'000}, max_label}) {
+      const auto expected = std::ranges::upper_bound(object_labels, label) -
+                            object_labels.begin();
+      const auto obj = object_id(object);
+      REQUIRE(br.rank(obj, obj, label_id(label)) == expected);
+    }
+  }
+}
+
 TEST_CASE("Size and alphabets size") {
   const auto binrel = make_test_binary_relation_2();
   CHECK(binrel.size() == 38);
@@ -1152,4 +1193,34 @@ TEST_CASE("count_distinct_labels, complex") {
   CHECK(count_labels(4_lab, 8_lab) == 4);
 }
 
+TEST_CASE("binary_relation: images") {
+  const auto br = make_test_binary_relation();
+  brwt::image img;
+  br.save(img);
+
+  SUBCASE("round trip") {
+    brwt::image_reader reader(img);
+    const auto view = binary_relation::view(reader);
+    CHECK(reader.remaining() == 0);
+
+    REQUIRE(view.size() == br.size());
+    REQUIRE(view.object_alphabet_size() == br.object_alphabet_size());
+    REQUIRE(view.label_alphabet_size() == br.label_alphabet_size());
+    for (unsigned x = 0; x < 12; ++x) {
+      for (unsigned a = 0; a < 10; ++a) {
+        const auto obj = static_cast<object_id>(x);
+        const auto lab = static_cast<label_id>(a);
+        REQUIRE(view.rank(obj, lab) == br.rank(obj, lab));
+        REQUIRE(view.count_distinct_labels(0_obj, obj, lab, 9_lab) ==
+                br.count_distinct_labels(0_obj, obj, lab, 9_lab));
+      }
+    }
+  }
+  SUBCASE("truncated image") {
+    img.pop_back();
+    brwt::image_reader reader(img);
+    CHECK_THROWS_AS(binary_relation::view(reader), std::length_error);
+  }
+}
+
 TEST_SUITE_END();
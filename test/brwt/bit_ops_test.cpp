@@ -1,6 +1,11 @@
 #include "brwt/bit_ops.h"
 #include <doctest/doctest.h>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
 
 /// TODO(Diego): Test used_bits
 
@@ -141,6 +146,119 @@ TEST_CASE("[rank_1][integer][end_position]") {
   static_assert(noexcept(rank_1(0ULL, 0)));
 }
 
+// Naive in-word selection used as reference.
+static int naive_select_1(const uint64_t value, const int nth) {
+  int count = 0;
+  for (int pos = 0; pos < 64; ++pos) {
+    if (((value >> pos) & 1) != 0 && ++count == nth) {
+      return pos;
+    }
+  }
+  return -1;
+}
+
+TEST_CASE("[select_1][integer]") {
+  using brwt::select_1;
+
+  static_assert(select_1<uint32_t>(0b0001, 1) == 0);
+  static_assert(select_1<uint32_t>(0b1010, 1) == 1);
+  static_assert(select_1<uint32_t>(0b1010, 2) == 3);
+  static_assert(select_1<uint32_t>(0x8000'0000, 1) == 31);
+  static_assert(select_1<uint32_t>(0xFFFF'FFFF, 32) == 31);
+
+  static_assert(select_1<uint64_t>(0x8940'1258'4123'5983, 1) == 0);
+  static_assert(select_1<uint64_t>(0x8940'1258'4123'5983, 7) == 14);
+  static_assert(select_1<uint64_t>(0x8940'1258'4123'5983, 8) == 16);
+  static_assert(select_1<uint64_t>(0x8940'1258'4123'5983, 12) == 30);
+  static_assert(select_1<uint64_t>(0x8940'1258'4123'5983, 21) == 63);
+  static_assert(select_1<uint64_t>(0xFFFF'FFFF'FFFF'FFFF, 64) == 63);
+
+  static_assert(noexcept(select_1(1U, 1)));
+  static_assert(noexcept(select_1(1UL, 1)));
+  static_assert(noexcept(select_1(1ULL, 1)));
+
+  // Run time path (which might use BMI2) against a naive selection.
+  const uint64_t values[] = {
+      0x0000'0000'0000'0001, 0x8000'0000'0000'0000, 0xFFFF'FFFF'FFFF'FFFF,
+      0x8940'1258'4123'5983, 0x00FF'0F0F'0F0F'FF72, 0x1211'1128'4281'1488,
+      0xAAAA'AAAA'AAAA'AAAA, 0x0000'0001'0000'0000, 0xF000'0000'0000'000F,
+  };
+  for (const auto value : values) {
+    for (int nth = 1; nth <= brwt::rank_1(value); ++nth) {
+      CHECK(select_1(value, nth) == naive_select_1(value, nth));
+    }
+  }
+  CHECK(select_1<uint32_t>(0xFFFF'FFFF, 32) == 31);
+}
+
+TEST_CASE("[select_0][integer]") {
+  using brwt::select_0;
+
+  static_assert(select_0<uint32_t>(0b1110, 1) == 0);
+  static_assert(select_0<uint32_t>(0b0101, 1) == 1);
+  static_assert(select_0<uint32_t>(0b0101, 2) == 3);
+  static_assert(select_0<uint32_t>(0x7FFF'FFFF, 1) == 31);
+  static_assert(select_0<uint32_t>(0x0000'0000, 32) == 31);
+
+  static_assert(select_0<uint64_t>(0x0000'0000'0000'0000, 64) == 63);
+  static_assert(select_0<uint64_t>(0x76BF'EDA7'BEDC'A67C, 1) == 0);
+  static_assert(select_0<uint64_t>(0x76BF'EDA7'BEDC'A67C, 21) == 63);
+
+  static_assert(noexcept(select_0(1U, 1)));
+  static_assert(noexcept(select_0(1UL, 1)));
+  static_assert(noexcept(select_0(1ULL, 1)));
+
+  CHECK(select_0<uint32_t>(0x0000'0000, 32) == 31);
+  CHECK(select_0<uint64_t>(0x76BF'EDA7'BEDC'A67C, 8) == 16);
+}
+
+TEST_CASE("popcount and prefix_popcount") {
+  using brwt::word_type;
+  using brwt::detail::popcount_kernel;
+
+  std::mt19937_64 engine{42};
+  std::vector<word_type> words(1000);
+  for (auto& word : words) {
+    word = engine();
+  }
+  words[3] = 0;
+  words[7] = ~word_type{0};
+
+  const auto kernels = {popcount_kernel::scalar, popcount_kernel::avx2,
+                        popcount_kernel::avx512};
+  // The sizes cover the vector widths and the unrolled loops, with and
+  // without a tail.
+  for (const std::size_t size : {0, 1, 3, 4, 7, 8, 9, 63, 64, 65, 255, 256,
+                                 1000}) {
+    const auto input = std::span(words).first(size);
+
+    std::vector<word_type> expected(size);
+    word_type sum = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+      sum += static_cast<word_type>(std::popcount(input[i]));
+      expected[i] = sum;
+    }
+
+    CHECK(brwt::popcount(input) == static_cast<std::int64_t>(sum));
+    std::vector<word_type> out(size);
+    brwt::prefix_popcount(input, out);
+    CHECK(out == expected);
+
+    for (const auto kernel : kernels) {
+      if (!brwt::detail::is_supported(kernel)) {
+        continue;
+      }
+      CAPTURE(static_cast<int>(kernel));
+      CHECK(brwt::detail::popcount(input, kernel) ==
+            static_cast<std::int64_t>(sum));
+
+      std::vector<word_type> kernel_out(size);
+      brwt::detail::prefix_popcount(input, kernel_out, kernel);
+      CHECK(kernel_out == expected);
+    }
+  }
+}
+
 TEST_CASE("is_power_of_two") {
   using brwt::is_power_of_two;
 
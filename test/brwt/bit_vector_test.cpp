@@ -1,8 +1,18 @@
 #include "brwt/bit_vector.h"
+#include "brwt/block_allocator.h"
+#include "brwt/image.h"
+#include "brwt/utility.h"
 #include <doctest/doctest.h>
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <ostream>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 // TODO(Diego): Test size() instead of length(). Remove length(). Test
 // num_blocks(). Test data().
@@ -97,6 +107,71 @@ TEST_CASE("bit_vector::bit_vector(const std::string&)") {
   CHECK(v.get_chunk(/*pos=*/192, /*count=*/18) == 0x3FFFF);
 }
 
+TEST_CASE("bit_vector: bulk constructors") {
+  // Generates an irregular pattern of bits that crosses several blocks.
+  std::vector<bool> pattern;
+  for (int i = 0; i < 300; ++i) {
+    pattern.push_back((i * i + i / 7) % 3 == 0);
+  }
+
+  for (const bit_vector::size_type size : {0, 1, 63, 64, 65, 128, 200, 300}) {
+    bit_vector expected(size);
+    std::string str;
+    std::vector<std::uint8_t> bytes((static_cast<std::size_t>(size) + 7) / 8);
+    auto bools = std::make_unique<bool[]>(static_cast<std::size_t>(size) + 1);
+    for (bit_vector::size_type i = 0; i < size; ++i) {
+      const auto idx = static_cast<std::size_t>(i);
+      expected.set(i, pattern[idx]);
+      str.insert(str.begin(), pattern[idx] ? '1' : '0');
+      bools[idx] = pattern[idx];
+      bytes[idx / 8] |= static_cast<std::uint8_t>(pattern[idx] << (idx % 8));
+    }
+    CAPTURE(size);
+
+    CHECK(bit_vector(str) == expected);
+    const auto num_bools = static_cast<std::size_t>(size);
+    CHECK(bit_vector(std::span<const bool>(bools.get(), num_bools)) ==
+          expected);
+    CHECK(bit_vector(bytes, size) == expected);
+
+    // Bits past the count are not copied.
+    std::ranges::fill(bytes, std::uint8_t{0xFF});
+    bytes.push_back(0xFF);
+    const bit_vector ones(bytes, size);
+    CHECK(ones == bit_vector(std::string(num_bools, '1')));
+    if (size > 0) {
+      CHECK(ones.get_block(ones.num_blocks() - 1) ==
+            bit_vector(std::string(num_bools, '1'))
+                .get_block(ones.num_blocks() - 1));
+    }
+  }
+
+  SUBCASE("from blocks") {
+    bit_vector::storage_type blocks(2);
+    blocks.reserve(3); // Room for the padding block.
+    blocks[0] = 0x1234;
+    blocks[1] = ~bit_vector::block_type{0};
+    const auto* const data = blocks.data();
+    const bit_vector v(70, std::move(blocks));
+    CHECK(v.length() == 70);
+    CHECK(v.get_blocks().data() == data);
+    CHECK(v.get_block(0) == 0x1234);
+    CHECK(v.get_block(1) == 0x3F);
+  }
+
+  SUBCASE("for overwrite") {
+    auto v = bit_vector::for_overwrite(70);
+    CHECK(v.length() == 70);
+    const auto blocks = v.get_mutable_blocks();
+    REQUIRE(blocks.size() == 2);
+    blocks[0] = 0x1234;
+    blocks[1] = 0x3F;
+    CHECK(v.get_block(0) == 0x1234);
+    CHECK(v.get_chunk(64, 6) == 0x3F);
+    CHECK(bit_vector::for_overwrite(0).num_blocks() == 0);
+  }
+}
+
 TEST_CASE("bit_vector::length()") {
   CHECK(bit_vector().length() == 0);
   CHECK(bit_vector(0).length() == 0);
@@ -190,6 +265,102 @@ TEST_CASE("bit_vector::set_chunk") {
   static_assert(noexcept(bit_vector().set_chunk(0, 8, 0xFF)));
 }
 
+TEST_CASE("bit_vector: chunks at every offset") {
+  // Writes chunks of every length at every position of a vector whose last
+  // block is full, so the chunks at the end touch the padding block.
+  constexpr auto bpb = bit_vector::bits_per_block;
+  for (bit_vector::size_type count = 0; count <= bpb; ++count) {
+    for (bit_vector::size_type pos = 0; pos + count <= 2 * bpb; ++pos) {
+      bit_vector v(2 * bpb);
+      v.set_block(0, 0x0123'4567'89AB'CDEF);
+      v.set_block(1, 0xFEDC'BA98'7654'3210);
+      const auto before = v;
+
+      v.set_chunk(pos, count, ~bit_vector::block_type{0});
+      for (bit_vector::size_type i = 0; i < v.size(); ++i) {
+        const bool inside = i >= pos && i < pos + count;
+        REQUIRE(v.get(i) == (inside || before.get(i)));
+      }
+      const auto ones = ~bit_vector::block_type{0};
+      REQUIRE(v.get_chunk(pos, count) ==
+              (count == bpb ? ones : ~(ones << count)));
+    }
+  }
+}
+
+TEST_CASE("bit_vector: copy_bits") {
+  using size_type = bit_vector::size_type;
+  constexpr size_type len = 300;
+
+  auto make_vector = [](const std::uint64_t seed) {
+    bit_vector v(len);
+    auto x = seed;
+    for (size_type i = 0; i < len; ++i) {
+      x = x * 6364136223846793005 + 1442695040888963407;
+      v.set(i, (x >> 63) != 0);
+    }
+    return v;
+  };
+  auto copy_bitwise = [](bit_vector& dst, const bit_vector& src,
+                         const size_type src_pos, const size_type dst_pos,
+                         const size_type count) {
+    const auto copy = src; // The ranges may overlap.
+    for (size_type i = 0; i < count; ++i) {
+      dst.set(dst_pos + i, copy.get(src_pos + i));
+    }
+  };
+
+  const auto src = make_vector(1);
+  const auto dst = make_vector(2);
+  for (const size_type count : {0, 1, 63, 64, 65, 130, 200}) {
+    for (size_type src_pos = 0; src_pos + count <= len; src_pos += 7) {
+      for (size_type dst_pos = 0; dst_pos + count <= len; dst_pos += 11) {
+        auto actual = dst;
+        auto expected = dst;
+        actual.copy_bits(src, src_pos, dst_pos, count);
+        copy_bitwise(expected, src, src_pos, dst_pos, count);
+        REQUIRE(
+            std::ranges::equal(actual.get_blocks(), expected.get_blocks()));
+
+        // Overlapping ranges of the same vector.
+        actual = src;
+        expected = src;
+        actual.copy_bits(actual, src_pos, dst_pos, count);
+        copy_bitwise(expected, expected, src_pos, dst_pos, count);
+        REQUIRE(
+            std::ranges::equal(actual.get_blocks(), expected.get_blocks()));
+      }
+    }
+  }
+}
+
+TEST_CASE("bit_vector::resize") {
+  bit_vector vec;
+  CHECK(vec.capacity() == 0);
+
+  vec.resize(70);
+  CHECK(vec.length() == 70);
+  CHECK(vec.capacity() >= 70);
+  vec.set_chunk(60, 10, 0x3FF);
+
+  // The bits that are cut off are zero when the vector grows back.
+  vec.resize(63);
+  CHECK(vec.get_chunk(60, 3) == 0x7);
+  vec.resize(200);
+  CHECK(vec.get_chunk(60, 64) == 0x7);
+  CHECK(vec.get_chunk(136, 64) == 0);
+
+  vec.resize(0);
+  CHECK(vec.length() == 0);
+  vec.resize(10);
+  CHECK(vec.get_chunk(0, 10) == 0);
+
+  vec.reserve(1000);
+  CHECK(vec.capacity() >= 1000);
+  vec.shrink_to_fit();
+  CHECK(vec.capacity() == 64);
+}
+
 TEST_CASE("bit_vector::get_block") {
   constexpr auto bpb = bit_vector::bits_per_block;
 
@@ -233,4 +404,114 @@ TEST_CASE("bit_vector::set_block") {
   static_assert(noexcept(bit_vector().set_block(0, 0xFFFF)));
 }
 
+TEST_CASE("bit_vector_builder") {
+  using brwt::bit_vector_builder;
+  constexpr auto bpb = bit_vector::bits_per_block;
+
+  SUBCASE("empty") {
+    const auto v = bit_vector_builder().build();
+    CHECK(v.length() == 0);
+    CHECK(v.num_blocks() == 0);
+  }
+  SUBCASE("push_back") {
+    const std::string s = "1011000111101011111000010101000001111101110010101"
+                          "1100111100010101101001111100000101011110010101";
+    bit_vector_builder builder;
+    for (auto it = s.rbegin(); it != s.rend(); ++it) {
+      builder.push_back(*it == '1');
+    }
+    CHECK(builder.size() == static_cast<bit_vector::size_type>(s.size()));
+    CHECK(std::move(builder).build() == bit_vector(s));
+  }
+  SUBCASE("append_bits and append") {
+    // Appends chunks of every length at every offset, and checks them against
+    // a bit vector filled with set_chunk.
+    bit_vector expected(40 * bpb);
+    bit_vector_builder builder;
+    bit_vector::size_type pos = 0;
+    bit_vector::block_type value = 0x9E37'79B9'7F4A'7C15;
+    for (bit_vector::size_type count = 0; count <= bpb; ++count) {
+      expected.set_chunk(pos, count, value);
+      builder.append_bits(value, count);
+      pos += count;
+      value = value * 0xBF58'476D'1CE4'E5B9 + 1;
+    }
+    for (const auto count : {3, 0, 64, 1, 200, 64, 5, 130}) {
+      const bool bit = count % 2 == 1;
+      for (bit_vector::size_type i = 0; i < count; ++i) {
+        expected.set(pos + i, bit);
+      }
+      builder.append(count, bit);
+      pos += count;
+    }
+    REQUIRE(builder.size() == pos);
+
+    const auto v = std::move(builder).build();
+    REQUIRE(v.length() == pos);
+    for (bit_vector::size_type i = 0; i < pos; ++i) {
+      REQUIRE(v.get(i) == expected.get(i));
+    }
+    // The unused bits of the last block are zero.
+    CHECK(v.get_block(v.num_blocks() - 1) ==
+          expected.get_block(v.num_blocks() - 1));
+  }
+  SUBCASE("allocation policy") {
+    bit_vector_builder builder(brwt::allocation_policy::huge_pages);
+    builder.reserve(1000);
+    builder.append(1000, true);
+    const auto v = std::move(builder).build();
+    CHECK(v.get_allocation_policy() == brwt::allocation_policy::huge_pages);
+    CHECK(v.num_blocks() == brwt::ceil_div<bit_vector::size_type>(1000, bpb));
+  }
+}
+
+TEST_CASE("bit_vector: images") {
+  using size_type = bit_vector::size_type;
+  SUBCASE("round trip") {
+    for (const size_type count : {0, 1, 64, 100, 1000}) {
+      bit_vector v(count);
+      for (size_type i = 0; i < count; i += 3) {
+        v.set(i, true);
+      }
+      brwt::image img;
+      v.save(img);
+      v.save(img);
+
+      brwt::image_reader reader(img);
+      const auto first = bit_vector::view(reader);
+      const auto second = bit_vector::view(reader);
+      CHECK(reader.remaining() == 0);
+
+      for (const auto* w : {&first, &second}) {
+        REQUIRE(w->length() == count);
+        CHECK(w->allocated_bytes() == 0);
+        for (size_type i = 0; i < count; ++i) {
+          REQUIRE(w->get(i) == v.get(i));
+        }
+        for (size_type i = 0; i + 40 <= count; i += 7) {
+          REQUIRE(w->get_chunk(i, 40) == v.get_chunk(i, 40));
+        }
+      }
+      if (count > 0) {
+        // The blocks are read in place.
+        const auto* blocks = second.get_blocks().data();
+        CHECK(static_cast<const void*>(blocks) >= img.data());
+        CHECK(static_cast<const void*>(blocks) < img.data() + img.size());
+      }
+
+      // Copies view the same blocks.
+      const auto copy = first; // NOLINT
+      CHECK(copy.get_blocks().data() == first.get_blocks().data());
+    }
+  }
+  SUBCASE("truncated image") {
+    bit_vector v(1000);
+    brwt::image img;
+    v.save(img);
+    img.pop_back();
+    brwt::image_reader reader(img);
+    CHECK_THROWS_AS(bit_vector::view(reader), std::length_error);
+  }
+}
+
 TEST_SUITE_END();
@@ -1,11 +1,21 @@
 #include "brwt/bitmap.h"
+#include "test_utility.h"
 #include "brwt/bit_vector.h"
+#include "brwt/image.h"
 #include <doctest/doctest.h>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 using brwt::bit_vector;
 using brwt::bitmap;
+using brwt::bitmap_options;
+using brwt::test::gen_bit_vector;
 
 using size_type = bitmap::size_type;
 using index_type = bitmap::index_type;
@@ -315,3 +325,414 @@ TEST_CASE("bitmap::select_0()") {
     CHECK(bm3.select_0(5) == -1);
   }
 }
+
+TEST_CASE("bitmap: rank and select agree with a sequential scan") {
+  // The sizes cover partial blocks, partial super blocks and several super
+  // blocks.
+  for (const size_type size : {1, 63, 64, 65, 511, 512, 513, 4000, 10'000}) {
+    for (const double density : {0.0, 0.03, 0.5, 0.97, 1.0}) {
+      const auto vec = gen_bit_vector(size, density);
+      const auto bm = bitmap(vec);
+
+      size_type ones = 0;
+      size_type zeros = 0;
+      for (index_type i = 0; i < size; ++i) {
+        if (vec.get(i)) {
+          ++ones;
+          REQUIRE(bm.select_1(ones) == i);
+        } else {
+          ++zeros;
+          REQUIRE(bm.select_0(zeros) == i);
+        }
+        REQUIRE(bm.rank_1(i) == ones);
+        REQUIRE(bm.rank_0(i) == zeros);
+      }
+      CHECK(bm.num_ones() == ones);
+      CHECK(bm.num_zeros() == zeros);
+      CHECK(bm.select_1(ones + 1) == -1);
+      CHECK(bm.select_0(zeros + 1) == -1);
+    }
+  }
+}
+
+TEST_CASE("bitmap::select_next_1() and bitmap::select_next_0()") {
+  for (const size_type size : {1, 63, 64, 65, 511, 512, 513, 4000}) {
+    for (const double density : {0.0, 0.002, 0.5, 0.998, 1.0}) {
+      const auto vec = gen_bit_vector(size, density);
+      const auto bm = bitmap(vec);
+
+      // Compute the expected answers scanning backwards.
+      index_type next_1 = -1;
+      index_type next_0 = -1;
+      REQUIRE(bm.select_next_1(size) == -1);
+      REQUIRE(bm.select_next_0(size) == -1);
+      for (index_type i = size - 1; i >= 0; --i) {
+        (vec.get(i) ? next_1 : next_0) = i;
+        REQUIRE(bm.select_next_1(i) == next_1);
+        REQUIRE(bm.select_next_0(i) == next_0);
+      }
+    }
+  }
+}
+
+TEST_CASE("bitmap: enumeration of ones and zeros") {
+  static_assert(std::forward_iterator<bitmap::one_iterator>);
+  static_assert(std::forward_iterator<bitmap::zero_iterator>);
+
+  for (const size_type size : {0, 1, 63, 64, 65, 200, 1000}) {
+    for (const double density : {0.0, 0.02, 0.5, 1.0}) {
+      const auto vec = gen_bit_vector(size, density);
+      const auto bm = bitmap(vec);
+
+      for (index_type first = 0; first <= size; first += 7) {
+        for (const size_type len : {0, 1, 5, 64, 65, 130, 1000}) {
+          const auto last = std::min(first + len, size);
+          std::vector<index_type> expected_ones;
+          std::vector<index_type> expected_zeros;
+          for (index_type i = first; i < last; ++i) {
+            (vec.get(i) ? expected_ones : expected_zeros).push_back(i);
+          }
+
+          std::vector<index_type> ones;
+          std::vector<index_type> zeros;
+          bm.for_each_one(first, last,
+                          [&](index_type i) { ones.push_back(i); });
+          bm.for_each_zero(first, last,
+                           [&](index_type i) { zeros.push_back(i); });
+          REQUIRE(ones == expected_ones);
+          REQUIRE(zeros == expected_zeros);
+
+          const auto one_range = bm.ones(first, last);
+          const auto zero_range = bm.zeros(first, last);
+          REQUIRE(std::ranges::equal(one_range, expected_ones));
+          REQUIRE(std::ranges::equal(zero_range, expected_zeros));
+        }
+      }
+    }
+  }
+}
+
+// Checks the range rank of the given bitmap against the single position rank.
+template <typename Bitmap>
+static void check_range_rank(const Bitmap& bm) {
+  auto ones_before = [&](const index_type pos) {
+    return pos == 0 ? 0 : bm.rank_1(pos - 1);
+  };
+  const auto size = bm.size();
+  for (index_type first = 0; first <= size; ++first) {
+    for (const size_type len : {0, 1, 2, 63, 64, 65, 511, 512, 1000}) {
+      const auto last = std::min(first + len, size);
+      const auto [first_ones, last_ones] = bm.rank_1(first, last);
+      REQUIRE(first_ones == ones_before(first));
+      REQUIRE(last_ones == ones_before(last));
+
+      const auto [first_zeros, last_zeros] = bm.rank_0(first, last);
+      REQUIRE(first_zeros == first - first_ones);
+      REQUIRE(last_zeros == last - last_ones);
+    }
+  }
+}
+
+TEST_CASE("bitmap: range rank agrees with single ranks") {
+  for (const size_type size : {0, 1, 64, 65, 511, 512, 513, 3000}) {
+    for (const double density : {0.0, 0.5, 1.0}) {
+      check_range_rank(bitmap(gen_bit_vector(size, density)));
+    }
+  }
+}
+
+TEST_CASE("bitmap: batched queries agree with single queries") {
+  for (const size_type size : {1, 100, 4000, 30'000}) {
+    const auto bm = bitmap(gen_bit_vector(size, 0.4));
+
+    // More queries than the batch size, including out of range nths.
+    std::vector<index_type> positions;
+    std::vector<size_type> nths;
+    for (index_type i = 0; i < 100; ++i) {
+      positions.push_back((i * 7919) % size);
+      nths.push_back(1 + (i * 104'729) % (size + 2));
+    }
+
+    std::vector<size_type> ranks(positions.size());
+    bm.rank_1(positions, ranks);
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      REQUIRE(ranks[i] == bm.rank_1(positions[i]));
+    }
+
+    std::vector<index_type> selects(nths.size());
+    bm.select_1(nths, selects);
+    for (std::size_t i = 0; i < nths.size(); ++i) {
+      REQUIRE(selects[i] == bm.select_1(nths[i]));
+    }
+    bm.select_0(nths, selects);
+    for (std::size_t i = 0; i < nths.size(); ++i) {
+      REQUIRE(selects[i] == bm.select_0(nths[i]));
+    }
+  }
+}
+
+// Checks that `bm` is the bitmap of `vec`.
+template <typename Bitmap>
+static void check_same_as(const Bitmap& bm, const bit_vector& vec) {
+  const auto expected = bitmap(vec);
+  REQUIRE(bm.size() == expected.size());
+  REQUIRE(bm.num_ones() == expected.num_ones());
+  for (index_type i = 0; i < bm.size(); ++i) {
+    REQUIRE(bm.access(i) == expected.access(i));
+    REQUIRE(bm.rank_1(i) == expected.rank_1(i));
+  }
+  for (size_type nth = 1; nth <= bm.num_ones() + 1; ++nth) {
+    REQUIRE(bm.select_1(nth) == expected.select_1(nth));
+  }
+  for (size_type nth = 1; nth <= bm.num_zeros() + 1; ++nth) {
+    REQUIRE(bm.select_0(nth) == expected.select_0(nth));
+  }
+}
+
+// Applies `op` to each pair of bits of `lhs` and `rhs`.
+template <typename Operation>
+static bit_vector apply(const bit_vector& lhs, const bit_vector& rhs,
+                        Operation op) {
+  bit_vector result(lhs.size());
+  for (index_type i = 0; i < lhs.size(); ++i) {
+    result.set(i, op(lhs.get(i), rhs.get(i)));
+  }
+  return result;
+}
+
+TEST_CASE("bitmap: bitwise operations") {
+  using packed_bitmap = brwt::basic_bitmap<brwt::packed_layout>;
+
+  auto bit_and = [](bool a, bool b) { return a && b; };
+  auto bit_or = [](bool a, bool b) { return a || b; };
+  auto bit_xor = [](bool a, bool b) { return a != b; };
+  auto bit_andnot = [](bool a, bool b) { return a && !b; };
+
+  for (const size_type size : {0, 1, 64, 65, 513, 5000}) {
+    const auto lhs_vec = gen_bit_vector(size, 0.5);
+    const auto rhs_vec = gen_bit_vector(size, 0.7);
+    const auto lhs = bitmap(lhs_vec);
+    const auto rhs = bitmap(rhs_vec);
+
+    check_same_as(lhs.bit_and(rhs), apply(lhs_vec, rhs_vec, bit_and));
+    check_same_as(lhs.bit_or(rhs), apply(lhs_vec, rhs_vec, bit_or));
+    check_same_as(lhs.bit_xor(rhs), apply(lhs_vec, rhs_vec, bit_xor));
+    check_same_as(lhs.bit_andnot(rhs), apply(lhs_vec, rhs_vec, bit_andnot));
+
+    const auto packed = packed_bitmap(lhs_vec).bit_xor(packed_bitmap(rhs_vec));
+    check_same_as(packed, apply(lhs_vec, rhs_vec, bit_xor));
+  }
+}
+
+// Generates `size` random bits a block at a time, which is fast enough for the
+// sequences that are split among several threads.
+static bit_vector gen_random_blocks(const size_type size) {
+  std::mt19937_64 engine{static_cast<std::mt19937_64::result_type>(size)};
+  bit_vector::storage_type blocks(static_cast<std::size_t>(
+      (size + bit_vector::bits_per_block - 1) / bit_vector::bits_per_block));
+  std::ranges::generate(blocks, engine);
+  return bit_vector(size, std::move(blocks));
+}
+
+// Checks that `bm` was built with the same directories as `reference`: their
+// images are equal, and the rank is the same in every block, at a different
+// offset of each one.
+template <typename Bitmap>
+static void check_same_directories(const Bitmap& bm, const Bitmap& reference) {
+  REQUIRE(bm.num_ones() == reference.num_ones());
+
+  brwt::image img;
+  bm.save(img);
+  brwt::image reference_img;
+  reference.save(reference_img);
+  REQUIRE(img == reference_img);
+
+  constexpr auto bits_per_block = bit_vector::bits_per_block;
+  for (index_type i = 0; i < bm.size(); i += bits_per_block + 1) {
+    REQUIRE(bm.rank_1(i) == reference.rank_1(i));
+  }
+}
+
+// The sequences have a few more super blocks than needed to be split among
+// three threads, so the chunks end in the middle of the sequence and the last
+// one is uneven.
+TEST_CASE("bitmap: parallel construction gives the same bitmap") {
+  constexpr auto bits_per_super_block =
+      brwt::rank9_layout::blocks_per_super_block * bit_vector::bits_per_block;
+  const auto vec =
+      gen_random_blocks(((size_type{3} << 14) + 37) * bits_per_super_block + 99);
+  const auto reference = bitmap(vec, bitmap_options{.num_threads = 1});
+
+  for (const int num_threads : {0, 2, 3, 7}) {
+    CAPTURE(num_threads);
+    check_same_directories(
+        bitmap(vec, bitmap_options{.num_threads = num_threads}), reference);
+  }
+
+  // Relative counters of a window must be built by a single thread.
+  using relative_bitmap = brwt::basic_bitmap<
+      brwt::rank_layout<8, brwt::counter_width::relative16, false>>;
+  check_same_directories(
+      relative_bitmap(vec, bitmap_options{.num_threads = 3}),
+      relative_bitmap(vec, bitmap_options{.num_threads = 1}));
+}
+
+// Each thread writes the packed counters of its own super blocks, which must
+// not share a word with the counters of another thread. Run it under
+// ThreadSanitizer to check that no word is touched by two threads.
+TEST_CASE("bitmap: parallel construction with packed counters") {
+  using packed_bitmap = brwt::basic_bitmap<brwt::packed_layout>;
+  const auto vec = gen_random_blocks(size_type{1} << 26);
+  const auto reference = packed_bitmap(vec, bitmap_options{.num_threads = 1});
+
+  for (const int num_threads : {2, 4, 5}) {
+    CAPTURE(num_threads);
+    check_same_directories(
+        packed_bitmap(vec, bitmap_options{.num_threads = num_threads}),
+        reference);
+  }
+}
+
+// Checks that the given layout answers as the default one.
+template <typename Layout>
+static void check_layout() {
+  for (const size_type size : {1, 255, 256, 257, 2047, 2048, 2049, 20'000}) {
+    for (const double density : {0.0, 0.02, 0.5, 0.98, 1.0}) {
+      const auto vec = gen_bit_vector(size, density);
+      const auto expected = bitmap(vec);
+      const auto bm = brwt::basic_bitmap<Layout>(vec);
+
+      REQUIRE(bm.num_ones() == expected.num_ones());
+      for (index_type i = 0; i < size; ++i) {
+        REQUIRE(bm.rank_1(i) == expected.rank_1(i));
+        REQUIRE(bm.select_next_0(i) == expected.select_next_0(i));
+      }
+      for (size_type nth = 1; nth <= bm.num_ones() + 1; ++nth) {
+        REQUIRE(bm.select_1(nth) == expected.select_1(nth));
+      }
+      for (size_type nth = 1; nth <= bm.num_zeros() + 1; ++nth) {
+        REQUIRE(bm.select_0(nth) == expected.select_0(nth));
+      }
+      if (size <= 2049) {
+        check_range_rank(bm);
+      }
+    }
+  }
+}
+
+TEST_CASE("basic_bitmap: rank layouts") {
+  using brwt::counter_width;
+  using brwt::rank_layout;
+
+  check_layout<brwt::packed_layout>();
+  check_layout<rank_layout<4, counter_width::bits32, true>>();
+  check_layout<rank_layout<8, counter_width::bits32, false>>();
+  check_layout<rank_layout<16, counter_width::bits64, false>>();
+  check_layout<rank_layout<32, counter_width::packed, false>>();
+  check_layout<rank_layout<32, counter_width::bits32, false>>();
+  check_layout<rank_layout<4, counter_width::relative32, false>>();
+  check_layout<rank_layout<8, counter_width::relative16, false>>();
+}
+
+TEST_CASE("basic_bitmap: relative counters span several windows") {
+  using brwt::counter_width;
+  using brwt::rank_layout;
+  using layout = rank_layout<32, counter_width::relative16, false>;
+
+  // Windows of 2^16 bits, the last one possibly partial.
+  for (const size_type size : {65'536, 65'537, 300'000}) {
+    const auto vec = gen_bit_vector(size, 0.7);
+    const auto expected = bitmap(vec);
+    const auto bm = brwt::basic_bitmap<layout>(vec);
+
+    REQUIRE(bm.num_ones() == expected.num_ones());
+    for (index_type i = 0; i < size; i += 7) {
+      REQUIRE(bm.rank_1(i) == expected.rank_1(i));
+    }
+    for (size_type nth = 1; nth <= bm.num_ones() + 1; nth += 7) {
+      REQUIRE(bm.select_1(nth) == expected.select_1(nth));
+    }
+    for (size_type nth = 1; nth <= bm.num_zeros() + 1; nth += 7) {
+      REQUIRE(bm.select_0(nth) == expected.select_0(nth));
+    }
+  }
+}
+
+TEST_CASE("bitmap: select samples do not change the results") {
+  const auto vec = gen_bit_vector(20'000, 0.3);
+  const auto reference = bitmap(vec, bitmap_options{.select_sample_rate = 0});
+
+  for (const size_type rate : {1, 2, 7, 64, 513, 4096, 100'000}) {
+    const auto bm = bitmap(vec, bitmap_options{.select_sample_rate = rate});
+
+    for (size_type nth = 1; nth <= bm.num_ones() + 1; ++nth) {
+      REQUIRE(bm.select_1(nth) == reference.select_1(nth));
+    }
+    for (size_type nth = 1; nth <= bm.num_zeros() + 1; ++nth) {
+      REQUIRE(bm.select_0(nth) == reference.select_0(nth));
+    }
+  }
+}
+
+TEST_CASE("basic_bitmap: images") {
+  using brwt::counter_width;
+  using brwt::rank_layout;
+
+  const auto check_round_trip = [](const auto& bm) {
+    using bitmap_type = std::remove_cvref_t<decltype(bm)>;
+    brwt::image img;
+    bm.save(img);
+    brwt::image_reader reader(img);
+    const auto view = bitmap_type::view(reader);
+    CHECK(reader.remaining() == 0);
+    CHECK(view.allocated_bytes() == 0);
+
+    REQUIRE(view.size() == bm.size());
+    REQUIRE(view.num_ones() == bm.num_ones());
+    for (index_type i = 0; i < bm.size(); i += 5) {
+      REQUIRE(view.rank_1(i) == bm.rank_1(i));
+    }
+    for (size_type nth = 1; nth <= bm.num_ones() + 1; nth += 5) {
+      REQUIRE(view.select_1(nth) == bm.select_1(nth));
+    }
+    for (size_type nth = 1; nth <= bm.num_zeros() + 1; nth += 5) {
+      REQUIRE(view.select_0(nth) == bm.select_0(nth));
+    }
+  };
+
+  using packed_bitmap =
+      brwt::basic_bitmap<rank_layout<8, counter_width::packed, false>>;
+  using relative_bitmap =
+      brwt::basic_bitmap<rank_layout<32, counter_width::relative16, false>>;
+
+  SUBCASE("round trip") {
+    check_round_trip(bitmap());
+    for (const size_type size : {0, 1, 1000, 70'000}) {
+      const auto vec = gen_bit_vector(size, 0.4);
+      check_round_trip(bitmap(vec));
+      check_round_trip(bitmap(vec, bitmap_options{.select_sample_rate = 0}));
+      check_round_trip(bitmap(vec, bitmap_options{.select_sample_rate = 3}));
+      check_round_trip(packed_bitmap(vec));
+      check_round_trip(relative_bitmap(vec));
+    }
+  }
+  SUBCASE("corrupted image") {
+    const auto vec = gen_bit_vector(1000, 0.4);
+    brwt::image img;
+    bitmap(vec).save(img);
+
+    brwt::image truncated(img.begin(), img.end() - 1);
+    brwt::image_reader truncated_reader(truncated);
+    CHECK_THROWS_AS(bitmap::view(truncated_reader), std::length_error);
+
+    // Directories that belong to a shorter sequence.
+    brwt::image prefix;
+    vec.save(prefix);
+    brwt::image mismatched;
+    gen_bit_vector(5000, 0.4).save(mismatched);
+    mismatched.insert(mismatched.end(), img.begin() + std::ssize(prefix),
+                      img.end());
+    brwt::image_reader mismatched_reader(mismatched);
+    CHECK_THROWS_AS(bitmap::view(mismatched_reader), std::length_error);
+  }
+}
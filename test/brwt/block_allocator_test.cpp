@@ -0,0 +1,154 @@
+#include "brwt/block_allocator.h"
+#include "brwt/binary_relation.h"
+#include "brwt/bit_vector.h"
+#include "brwt/bitmap.h"
+#include "brwt/int_vector.h"
+#include <doctest/doctest.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+using brwt::allocation_policy;
+using brwt::binary_relation;
+using brwt::bit_vector;
+using brwt::bitmap;
+using brwt::block_alignment;
+using brwt::block_allocator;
+using brwt::int_vector;
+
+static bool is_aligned(const void* const ptr) {
+  return reinterpret_cast<std::uintptr_t>(ptr) % block_alignment == 0;
+}
+
+TEST_CASE("block_allocator: alignment") {
+  for (const auto policy :
+       {allocation_policy::aligned, allocation_policy::huge_pages}) {
+    // The last size is large enough to be backed by huge pages.
+    for (const std::size_t count : {1, 7, 1000, 1 << 20}) {
+      std::vector<std::uint64_t, block_allocator<std::uint64_t>> vec(
+          count, block_allocator<std::uint64_t>(policy));
+      CHECK(is_aligned(vec.data()));
+
+      vec.back() = 42;
+      vec.front() = 7;
+      CHECK(vec.back() == (count == 1 ? 7 : 42));
+    }
+  }
+}
+
+TEST_CASE("block_allocator: equality") {
+  const auto a = block_allocator<int>(allocation_policy::aligned);
+  const auto b = block_allocator<int>(allocation_policy::huge_pages);
+  CHECK(a == a);
+  CHECK(a != b);
+  CHECK(block_allocator<int>() == a);
+  CHECK(block_allocator<char>(b).policy() == allocation_policy::huge_pages);
+}
+
+TEST_CASE("block_allocator: the policy follows the structures") {
+  constexpr auto huge = allocation_policy::huge_pages;
+  auto vec = bit_vector(1 << 25, huge);
+  CHECK(vec.get_allocation_policy() == huge);
+  CHECK(is_aligned(vec.get_blocks().data()));
+
+  vec.set(0, true);
+  vec.set(vec.size() - 1, true);
+
+  SUBCASE("copy") {
+    const auto copy = vec; // NOLINT: This copy is intentional.
+    CHECK(copy.get_allocation_policy() == huge);
+    CHECK(copy.get(vec.size() - 1));
+  }
+  SUBCASE("assignment") {
+    auto other = bit_vector(10);
+    CHECK(other.get_allocation_policy() == allocation_policy::aligned);
+    other = vec;
+    CHECK(other.get_allocation_policy() == huge);
+    other = bit_vector(10);
+    CHECK(other.get_allocation_policy() == allocation_policy::aligned);
+  }
+  SUBCASE("bitmap") {
+    const auto bm = bitmap(std::move(vec));
+    CHECK(bm.num_ones() == 2);
+    CHECK(bm.rank_1(bm.size() - 1) == 2);
+  }
+  SUBCASE("int_vector") {
+    const auto ints = int_vector(1 << 20, 9, huge);
+    CHECK(ints.get_allocation_policy() == huge);
+    CHECK(int_vector(10, 3).get_allocation_policy() ==
+          allocation_policy::aligned);
+  }
+}
+
+TEST_CASE("block_allocator: memory resources") {
+  // Counts the bytes in use, and checks each deallocation against its
+  // allocation.
+  class counting_resource : public std::pmr::memory_resource {
+  public:
+    std::size_t bytes_in_use = 0;
+    std::size_t num_allocations = 0;
+
+  private:
+    void* do_allocate(const std::size_t bytes,
+                      const std::size_t alignment) override {
+      bytes_in_use += bytes;
+      ++num_allocations;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* const ptr, const std::size_t bytes,
+                       const std::size_t alignment) override {
+      REQUIRE(bytes <= bytes_in_use);
+      bytes_in_use -= bytes;
+      std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+    bool do_is_equal(const memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+  };
+
+  std::vector<binary_relation::pair_type> pairs;
+  for (int i = 0; i < 5000; ++i) {
+    pairs.push_back({binary_relation::object_id(i % 97),
+                     binary_relation::label_id((i * 7) % 31)});
+  }
+  const auto expected = binary_relation(pairs);
+
+  SUBCASE("every structure allocates from the resource") {
+    counting_resource resource;
+    {
+      const auto rel = binary_relation(pairs, &resource);
+      CHECK(resource.num_allocations > 0);
+      CHECK(resource.bytes_in_use > 0);
+      CHECK(rel.size() == expected.size());
+      CHECK(rel.rank(binary_relation::object_id(50),
+                     binary_relation::label_id(20)) ==
+            expected.rank(binary_relation::object_id(50),
+                          binary_relation::label_id(20)));
+
+      const auto copy = rel; // NOLINT: This copy is intentional.
+      CHECK(copy.size() == rel.size());
+    }
+    CHECK(resource.bytes_in_use == 0);
+  }
+  SUBCASE("monotonic arena") {
+    std::pmr::monotonic_buffer_resource arena;
+    const auto bm = bitmap(bit_vector(10'000, &arena));
+    CHECK(bm.num_ones() == 0);
+
+    const auto rel = binary_relation(pairs, &arena);
+    CHECK(rel.size() == expected.size());
+  }
+  SUBCASE("allocator equality") {
+    counting_resource resource;
+    const auto a = block_allocator<int>(&resource);
+    CHECK(a.resource() == &resource);
+    CHECK(block_allocator<char>(a).resource() == &resource);
+    CHECK(a != block_allocator<int>());
+    CHECK(block_allocator<int>(nullptr) == block_allocator<int>());
+    CHECK(bit_vector(100, &resource).get_allocator().resource() == &resource);
+  }
+}
+
+TEST_SUITE_END();
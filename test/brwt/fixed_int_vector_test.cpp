@@ -0,0 +1,136 @@
+#include "brwt/fixed_int_vector.h"
+#include "brwt/image.h"
+#include "brwt/int_vector.h"
+#include <doctest/doctest.h>
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+using brwt::fixed_int_vector;
+using brwt::int_vector;
+
+using vector20 = fixed_int_vector<20>;
+using value_t = vector20::value_type;
+using size_type = vector20::size_type;
+
+static_assert(std::is_nothrow_default_constructible_v<vector20>);
+static_assert(std::is_nothrow_move_constructible_v<vector20>);
+static_assert(std::is_nothrow_move_assignable_v<vector20>);
+static_assert(vector20::get_bpe() == 20);
+
+// Generates `count` values of 20 bits.
+static std::vector<value_t> gen_values(const size_type count) {
+  std::vector<value_t> values(static_cast<std::size_t>(count));
+  value_t x = 1;
+  for (auto& value : values) {
+    x = x * 6364136223846793005 + 1442695040888963407;
+    value = x >> 44;
+  }
+  return values;
+}
+
+// TEST_SUITE("fixed_int_vector");
+
+TEST_CASE("fixed_int_vector: element access") {
+  vector20 vec(10);
+  CHECK(vec.size() == 10);
+  CHECK(std::all_of(vec.begin(), vec.end(), [](value_t x) { return x == 0; }));
+
+  vec[0] = 0xFFFFF;
+  vec[3] = 12345;
+  vec.back() = 7;
+  const auto& cvec = vec;
+  CHECK(cvec.front() == 0xFFFFF);
+  CHECK(cvec[1] == 0);
+  CHECK(cvec[3] == 12345);
+  CHECK(cvec.back() == 7);
+
+  swap(vec[0], vec[3]);
+  CHECK(vec[0] == 12345);
+  CHECK(vec[3] == 0xFFFFF);
+
+  const vector20 ilist = {1, 2, 3};
+  CHECK(ilist.size() == 3);
+  CHECK(ilist[2] == 3);
+}
+
+TEST_CASE("fixed_int_vector: same contents as int_vector") {
+  const auto values = gen_values(1000);
+  vector20 fixed(1000);
+  int_vector dynamic(1000, 20);
+  fixed.encode(0, values);
+  dynamic.encode(0, values);
+
+  REQUIRE(std::equal(fixed.begin(), fixed.end(), dynamic.begin()));
+
+  for (const size_type first : {0, 5, 64, 100}) {
+    std::vector<value_t> out(500);
+    fixed.decode(first, out);
+    REQUIRE(std::equal(out.begin(), out.end(), values.begin() + first));
+  }
+
+  // Both classes use the same image format.
+  brwt::image img;
+  dynamic.save(img);
+  brwt::image_reader reader(img);
+  const auto view = vector20::view(reader);
+  CHECK(std::equal(view.begin(), view.end(), fixed.begin()));
+
+  brwt::image other;
+  int_vector(10, 13).save(other);
+  brwt::image_reader other_reader(other);
+  CHECK_THROWS_AS(vector20::view(other_reader), std::length_error);
+}
+
+TEST_CASE("fixed_int_vector: erase and equality") {
+  const auto values = gen_values(300);
+  vector20 vec(300);
+  vec.encode(0, values);
+  auto copy = vec;
+  CHECK(vec == copy);
+
+  copy[299] = 0;
+  CHECK_FALSE(vec == copy);
+
+  auto it = vec.erase(vec.begin() + 10, vec.begin() + 110);
+  CHECK(it == vec.begin() + 10);
+  REQUIRE(vec.size() == 200);
+  for (size_type i = 0; i < vec.size(); ++i) {
+    const auto src = static_cast<std::size_t>(i < 10 ? i : i + 100);
+    REQUIRE(vec[i] == values[src]);
+  }
+
+  vec.erase(vec.begin());
+  CHECK(vec.size() == 199);
+  CHECK(vec.front() == values[1]);
+
+  vec.clear();
+  CHECK(vec.empty());
+}
+
+TEST_CASE("fixed_int_vector: push_back and resize") {
+  const auto values = gen_values(1000);
+  vector20 vec;
+  for (const auto value : values) {
+    vec.push_back(value);
+  }
+  REQUIRE(vec.size() == 1000);
+  CHECK(vec.capacity() >= 1000);
+  CHECK(std::equal(vec.begin(), vec.end(), values.begin()));
+
+  vec.erase(vec.begin() + 5, vec.end());
+  vec.resize(8);
+  CHECK(vec[4] == values[4]);
+  CHECK(vec[5] == 0);
+  CHECK(vec[7] == 0);
+
+  vec.shrink_to_fit();
+  CHECK(vec.capacity() == 9);
+  vec.clear();
+  vec.resize(3);
+  CHECK(vec == vector20{0, 0, 0});
+}
+
+TEST_SUITE_END();
@@ -1,10 +1,13 @@
 #include "brwt/int_vector.h"
+#include "brwt/bit_ops.h"
 #include <doctest/doctest.h>
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <initializer_list>
 #include <iterator>
 #include <limits>
+#include <span>
 #include <stdexcept>
 #include <type_traits>
 #include <vector>
@@ -486,6 +489,94 @@ TEST_CASE_FIXTURE(int_vector_fixture, "operator==(int_vector,int_vector)") {
   CHECK(d == d);
 }
 
+TEST_CASE("int_vector: bulk decode and encode") {
+  using size_type = int_vector::size_type;
+  constexpr size_type count = 300;
+
+  for (int bpe = 0; bpe < std::numeric_limits<value_t>::digits; ++bpe) {
+    CAPTURE(bpe);
+    const auto mask = brwt::lsb_mask<value_t>(bpe);
+    std::vector<value_t> values(count);
+    value_t x = 1;
+    for (auto& value : values) {
+      x = x * 6364136223846793005 + 1442695040888963407;
+      value = (x >> 7) & mask;
+    }
+
+    for (const size_type first : {0, 1, 63, 64, 100}) {
+      for (const size_type len : {0, 1, 64, 65, 130, 200}) {
+        const auto input =
+            std::span(values).first(static_cast<std::size_t>(len));
+
+        int_vector vec(first + len + 3, bpe);
+        vec.encode(first, input);
+        for (size_type i = 0; i < vec.size(); ++i) {
+          const bool inside = i >= first && i < first + len;
+          const auto expected =
+              inside ? input[static_cast<std::size_t>(i - first)] : 0;
+          REQUIRE(vec[i] == expected);
+        }
+
+        std::vector<value_t> out(static_cast<std::size_t>(len));
+        vec.decode(first, out);
+        REQUIRE(std::ranges::equal(out, input));
+      }
+    }
+  }
+}
+
+TEST_CASE("operator==(int_vector,int_vector): long vectors") {
+  int_vector a(1000, 10);
+  int_vector b(1000, 10);
+  int_vector c(1000, 13);
+  for (int_vector::size_type i = 0; i < a.size(); ++i) {
+    a[i] = b[i] = c[i] = static_cast<value_t>(i % 1000);
+  }
+  CHECK(a == b);
+  CHECK(a == c);
+
+  b[999] = 1;
+  c[999] = 1;
+  CHECK_FALSE(a == b);
+  CHECK_FALSE(a == c);
+
+  // Elements erased from the end are not compared.
+  a.erase(a.end() - 1);
+  b.erase(b.end() - 1);
+  CHECK(a == b);
+}
+
+TEST_CASE("int_vector: push_back and resize") {
+  using size_type = int_vector::size_type;
+  int_vector vec(0, 11);
+  size_type reallocations = 0;
+  for (size_type i = 0; i < 5000; ++i) {
+    const auto old_capacity = vec.capacity();
+    vec.push_back(static_cast<value_t>(i % 2048));
+    reallocations += vec.capacity() != old_capacity ? 1 : 0;
+  }
+  REQUIRE(vec.size() == 5000);
+  CHECK(vec.capacity() >= vec.size());
+  CHECK(reallocations < 20);
+  for (size_type i = 0; i < vec.size(); ++i) {
+    REQUIRE(vec[i] == static_cast<value_t>(i % 2048));
+  }
+
+  // Erased elements do not come back on growth.
+  vec.erase(vec.begin() + 10, vec.end());
+  vec.resize(20);
+  CHECK(vec[9] == 9);
+  for (size_type i = 10; i < 20; ++i) {
+    REQUIRE(vec[i] == 0);
+  }
+
+  // 20 elements of 11 bits take 4 blocks, which hold 23 elements.
+  vec.shrink_to_fit();
+  CHECK(vec.capacity() == 23);
+  vec.reserve(100);
+  CHECK(vec.capacity() >= 100);
+}
+
 TEST_CASE("swap(reference, reference)") {
   int_vector v = {10, 20, 30, 40};
   swap(v.front(), v.back());
@@ -0,0 +1,82 @@
+#include "brwt/rrr_bitmap.h"
+#include "test_utility.h"
+#include "brwt/bit_vector.h"
+#include "brwt/bitmap.h"
+#include <doctest/doctest.h>
+
+using brwt::bit_vector;
+using brwt::bitmap;
+using brwt::rrr_bitmap;
+using brwt::test::gen_bit_vector;
+
+using size_type = rrr_bitmap::size_type;
+using index_type = rrr_bitmap::index_type;
+
+// TEST_SUITE("rrr_bitmap");
+
+TEST_CASE("rrr_bitmap::rrr_bitmap()") {
+  const rrr_bitmap bm;
+  CHECK(bm.size() == 0);
+  CHECK(bm.num_ones() == 0);
+  CHECK(bm.num_zeros() == 0);
+  CHECK(bm.select_1(1) == -1);
+  CHECK(bm.select_0(1) == -1);
+}
+
+TEST_CASE("rrr_bitmap: small sequence") {
+  const auto bm = rrr_bitmap(bit_vector("10100110101111"));
+
+  CHECK(bm.size() == 14);
+  CHECK(bm.num_ones() == 9);
+  CHECK(bm.num_zeros() == 5);
+
+  CHECK(bm.access(0));
+  CHECK(bm.access(3));
+  CHECK_FALSE(bm.access(4));
+  CHECK(bm.access(13));
+
+  CHECK(bm.rank_1(0) == 1);
+  CHECK(bm.rank_1(4) == 4);
+  CHECK(bm.rank_1(13) == 9);
+  CHECK(bm.rank_0(6) == 2);
+
+  CHECK(bm.select_1(5) == 5);
+  CHECK(bm.select_1(9) == 13);
+  CHECK(bm.select_1(10) == -1);
+  CHECK(bm.select_0(1) == 4);
+  CHECK(bm.select_0(5) == 12);
+  CHECK(bm.select_0(6) == -1);
+}
+
+TEST_CASE("rrr_bitmap: queries agree with bitmap") {
+  // The sizes cover partial blocks and several super blocks.
+  for (const size_type size : {1, 14, 15, 16, 479, 480, 481, 5000}) {
+    for (const double density : {0.0, 0.01, 0.2, 0.5, 0.99, 1.0}) {
+      const auto vec = gen_bit_vector(size, density);
+      const auto expected = bitmap(vec);
+      const auto bm = rrr_bitmap(vec);
+
+      REQUIRE(bm.size() == expected.size());
+      REQUIRE(bm.num_ones() == expected.num_ones());
+
+      for (index_type i = 0; i < size; ++i) {
+        REQUIRE(bm.access(i) == expected.access(i));
+        REQUIRE(bm.rank_1(i) == expected.rank_1(i));
+        REQUIRE(bm.rank_0(i) == expected.rank_0(i));
+      }
+      for (size_type nth = 1; nth <= bm.num_ones() + 1; ++nth) {
+        REQUIRE(bm.select_1(nth) == expected.select_1(nth));
+      }
+      for (size_type nth = 1; nth <= bm.num_zeros() + 1; ++nth) {
+        REQUIRE(bm.select_0(nth) == expected.select_0(nth));
+      }
+    }
+  }
+}
+
+TEST_CASE("rrr_bitmap: low entropy sequences use less space") {
+  const auto vec = gen_bit_vector(100'000, 0.01);
+  CHECK(rrr_bitmap(vec).allocated_bytes() < vec.allocated_bytes() / 2);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,126 @@
+#include "brwt/sparse_bitmap.h"
+#include "test_utility.h"
+#include "brwt/bit_vector.h"
+#include "brwt/bitmap.h"
+#include "brwt/image.h"
+#include <doctest/doctest.h>
+
+using brwt::bit_vector;
+using brwt::bitmap;
+using brwt::sparse_bitmap;
+using brwt::test::gen_bit_vector;
+
+using size_type = sparse_bitmap::size_type;
+using index_type = sparse_bitmap::index_type;
+
+// TEST_SUITE("sparse_bitmap");
+
+TEST_CASE("sparse_bitmap::sparse_bitmap()") {
+  const sparse_bitmap bm;
+  CHECK(bm.size() == 0);
+  CHECK(bm.num_ones() == 0);
+  CHECK(bm.num_zeros() == 0);
+  CHECK(bm.select_1(1) == -1);
+  CHECK(bm.select_0(1) == -1);
+}
+
+TEST_CASE("sparse_bitmap: small sequence") {
+  const auto bm = sparse_bitmap(bit_vector("10000001000000000100000000001001"));
+
+  CHECK(bm.size() == 32);
+  CHECK(bm.num_ones() == 5);
+  CHECK(bm.num_zeros() == 27);
+
+  CHECK(bm.access(0));
+  CHECK(bm.access(3));
+  CHECK_FALSE(bm.access(4));
+  CHECK(bm.access(31));
+
+  CHECK(bm.rank_1(0) == 1);
+  CHECK(bm.rank_1(3) == 2);
+  CHECK(bm.rank_1(31) == 5);
+  CHECK(bm.rank_0(5) == 4);
+
+  CHECK(bm.select_1(1) == 0);
+  CHECK(bm.select_1(2) == 3);
+  CHECK(bm.select_1(5) == 31);
+  CHECK(bm.select_1(6) == -1);
+  CHECK(bm.select_0(1) == 1);
+  CHECK(bm.select_0(3) == 4);
+  CHECK(bm.select_0(27) == 30);
+  CHECK(bm.select_0(28) == -1);
+}
+
+TEST_CASE("sparse_bitmap: queries agree with bitmap") {
+  for (const size_type size : {1, 2, 63, 64, 65, 1000, 5000}) {
+    for (const double density : {0.0, 0.001, 0.05, 0.3, 0.9, 1.0}) {
+      const auto vec = gen_bit_vector(size, density);
+      const auto expected = bitmap(vec);
+      const auto bm = sparse_bitmap(vec);
+
+      REQUIRE(bm.size() == expected.size());
+      REQUIRE(bm.num_ones() == expected.num_ones());
+
+      for (index_type i = 0; i < size; ++i) {
+        REQUIRE(bm.access(i) == expected.access(i));
+        REQUIRE(bm.rank_1(i) == expected.rank_1(i));
+        REQUIRE(bm.rank_0(i) == expected.rank_0(i));
+      }
+      for (size_type nth = 1; nth <= bm.num_ones() + 1; ++nth) {
+        REQUIRE(bm.select_1(nth) == expected.select_1(nth));
+      }
+      for (size_type nth = 1; nth <= bm.num_zeros() + 1; ++nth) {
+        REQUIRE(bm.select_0(nth) == expected.select_0(nth));
+      }
+    }
+  }
+}
+
+TEST_CASE("sparse_bitmap: select_0 across a long run of set bits") {
+  // Like the object bitmap of a binary_relation with many empty objects.
+  auto vec = gen_bit_vector(200'000, 0.005);
+  for (index_type i = 100'000; i < 110'000; ++i) {
+    vec.set(i, true);
+  }
+  const auto expected = bitmap(vec);
+  const auto bm = sparse_bitmap(vec);
+  REQUIRE(bm.allocated_bytes() < vec.allocated_bytes());
+
+  for (size_type nth = 1; nth <= bm.num_zeros() + 1; ++nth) {
+    REQUIRE(bm.select_0(nth) == expected.select_0(nth));
+  }
+}
+
+TEST_CASE("sparse_bitmap: sparse sequences use less space") {
+  const auto vec = gen_bit_vector(100'000, 0.01);
+  CHECK(sparse_bitmap(vec).allocated_bytes() < vec.allocated_bytes() / 4);
+}
+
+TEST_CASE("sparse_bitmap: dense sequences are stored as a bitmap") {
+  for (const double density : {0.3, 0.5, 0.9}) {
+    const auto vec = gen_bit_vector(100'000, density);
+    CHECK(sparse_bitmap(vec).allocated_bytes() <=
+          bitmap(vec).allocated_bytes());
+  }
+}
+
+TEST_CASE("sparse_bitmap: images") {
+  for (const double density : {0.0, 0.01, 0.5}) {
+    const auto vec = gen_bit_vector(10'000, density);
+    const auto bm = sparse_bitmap(vec);
+    brwt::image img;
+    bm.save(img);
+    brwt::image_reader reader(img);
+    const auto view = sparse_bitmap::view(reader);
+
+    REQUIRE(view.num_ones() == bm.num_ones());
+    for (size_type nth = 1; nth <= bm.num_zeros(); nth += 7) {
+      REQUIRE(view.select_0(nth) == bm.select_0(nth));
+    }
+    for (index_type i = 0; i < bm.size(); i += 7) {
+      REQUIRE(view.rank_1(i) == bm.rank_1(i));
+    }
+  }
+}
+
+TEST_SUITE_END();
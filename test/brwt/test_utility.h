@@ -0,0 +1,27 @@
+#ifndef BINREL_WT_TEST_UTILITY_H // NOLINT
+#define BINREL_WT_TEST_UTILITY_H
+
+#include "brwt/bit_vector.h"
+#include "brwt/common_types.h"
+#include <random>
+
+namespace brwt {
+namespace test {
+
+/// Generates a random bit sequence where each bit is set with probability
+/// `density`. The sequence only depends on its size and density.
+inline bit_vector gen_bit_vector(const size_type size, const double density) {
+  std::mt19937_64 engine{static_cast<std::mt19937_64::result_type>(size)};
+  std::bernoulli_distribution gen_bit(density);
+
+  bit_vector vec(size);
+  for (index_type i = 0; i < size; ++i) {
+    vec.set(i, gen_bit(engine));
+  }
+  return vec;
+}
+
+} // end namespace test
+} // end namespace brwt
+
+#endif // BINREL_WT_TEST_UTILITY_H
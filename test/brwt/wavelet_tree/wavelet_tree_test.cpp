@@ -1,5 +1,6 @@
 #include "brwt/wavelet_tree/wavelet_tree.h"
 #include "brwt/common_types.h"
+#include "brwt/fixed_int_vector.h"
 #include "brwt/int_vector.h"
 #include "brwt/wavelet_tree/algorithms.h"
 #include <doctest/doctest.h>
@@ -456,6 +457,55 @@ TEST_CASE("node_proxy: make lhs and rhs") {
         std::make_pair(rhs.make_lhs(), rhs.make_rhs()));
 }
 
+TEST_CASE("node_proxy: select next") {
+  const auto wt = wavelet_tree(create_vector_with_3_bpe());
+  // seq = EHDHACEEGBCBGCF
+
+  const auto root = wt.make_root(); // 110100111000101
+  const auto lhs = root.make_lhs(); // 1010101
+  const auto rhs = root.make_rhs(); // 01100110
+
+  CHECK(root.select_next_1(0) == 0);
+  CHECK(root.select_next_1(2) == 3);
+  CHECK(root.select_next_1(9) == 12);
+  CHECK(root.select_next_1(14) == 14);
+  CHECK(root.select_next_1(15) == -1);
+  CHECK(root.select_next_0(0) == 2);
+  CHECK(root.select_next_0(6) == 9);
+  CHECK(root.select_next_0(14) == -1);
+
+  CHECK(lhs.select_next_1(1) == 2);
+  CHECK(lhs.select_next_1(6) == 6);
+  CHECK(lhs.select_next_1(7) == -1);
+  CHECK(lhs.select_next_0(5) == 5);
+  CHECK(lhs.select_next_0(6) == -1);
+
+  // The answer must not leak into the following node.
+  CHECK(rhs.select_next_0(0) == 0);
+  CHECK(rhs.select_next_0(6) == 7);
+  CHECK(rhs.select_next_1(7) == -1);
+}
+
+TEST_CASE("node_proxy: range rank") {
+  const auto wt = wavelet_tree(create_vector_with_3_bpe());
+  // seq = EHDHACEEGBCBGCF
+
+  const auto root = wt.make_root(); // 110100111000101
+  const auto lhs = root.make_lhs(); // 1010101
+  const auto rhs = root.make_rhs(); // 01100110
+
+  using pair = std::pair<size_type, size_type>;
+  CHECK(root.rank_1(2, 9) == pair{2, 6});
+  CHECK(root.rank_0(2, 9) == pair{0, 3});
+  CHECK(root.rank_1(0, 15) == pair{0, 8});
+
+  CHECK(lhs.rank_1(1, 7) == pair{1, 4});
+  CHECK(lhs.rank_0(1, 7) == pair{0, 3});
+
+  CHECK(rhs.rank_0(3, 8) == pair{1, 4});
+  CHECK(rhs.rank_1(0, 0) == pair{0, 0});
+}
+
 // ==========================================
 // Extended algorithms
 // ==========================================
@@ -511,4 +561,48 @@ TEST_CASE("[wavelet_tree][select][between]") {
   CHECK(select('A', 'H', 399) == index_npos);
 }
 
+TEST_CASE("wavelet_tree: built from a fixed_int_vector") {
+  constexpr size_type count = 5000;
+  brwt::fixed_int_vector<13> fixed(count);
+  int_vector dynamic(count, /*bpe=*/13);
+  for (size_type i = 0; i < count; ++i) {
+    const auto value = static_cast<int_vector::value_type>(i * 7919 % 8192);
+    fixed[i] = value;
+    dynamic[i] = value;
+  }
+
+  const wavelet_tree expected(dynamic);
+  const wavelet_tree actual(fixed);
+  REQUIRE(actual.size() == count);
+  REQUIRE(actual.get_bits_per_symbol() == 13);
+  for (size_type i = 0; i < count; i += 7) {
+    REQUIRE(actual.access(i) == expected.access(i));
+    const auto symbol = static_cast<symbol_id>(std::as_const(dynamic)[i]);
+    REQUIRE(actual.rank(symbol, i) == expected.rank(symbol, i));
+  }
+}
+
+TEST_CASE("wavelet_tree: symbols too wide for a table") {
+  constexpr size_type count = 3000;
+  for (const auto bpe : {25, 40, 63}) {
+    CAPTURE(bpe);
+    int_vector seq(count, bpe);
+    const auto mask = (int_vector::value_type{1} << bpe) - 1;
+    for (size_type i = 0; i < count; ++i) {
+      // Few distinct symbols, spread over the whole alphabet.
+      const auto value = static_cast<int_vector::value_type>(i % 37);
+      seq[i] = (value * 0x9E3779B97F4A7C15) & mask;
+    }
+
+    const wavelet_tree wt(seq);
+    REQUIRE(wt.size() == count);
+    REQUIRE(wt.get_bits_per_symbol() == bpe);
+    for (size_type i = 0; i < count; i += 11) {
+      const auto symbol = static_cast<symbol_id>(std::as_const(seq)[i]);
+      REQUIRE(wt.access(i) == symbol);
+      REQUIRE(wt.rank(symbol, i) == i / 37 + 1);
+    }
+  }
+}
+
 TEST_SUITE_END();